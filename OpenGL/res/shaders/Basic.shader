@@ -1,34 +1,41 @@
  /* Shader source code. */
 
  #shader vertex
- #version 330 core
+ #version 420 core
      
  layout(location = 0) in vec4 position;
  layout(location = 1) in vec2 texCoord;
 
  out vec2 v_TexCoord;
 
- uniform mat4 u_MVP;
+ layout(std140, binding = 0) uniform Camera
+ {
+    mat4 u_ViewProjection;
+ };
+ uniform mat4 u_Model;
      
  void main()
  {
-    gl_Position = u_MVP * position;
+    gl_Position = u_ViewProjection * u_Model * position;
     v_TexCoord = texCoord;
  };
 
 
  #shader fragment
- #version 330 core
+ #version 420 core
      
  layout(location = 0) out vec4 color;
  
  in vec2 v_TexCoord;
 
- uniform vec4 u_Color;
+ layout(std140, binding = 1) uniform Material
+ {
+    vec4 u_Color;
+ };
  uniform sampler2D u_Texture;
 
  void main()
  {
     vec4 texColor = texture(u_Texture, v_TexCoord);
-    color = texColor;
+    color = texColor * u_Color;
  };
\ No newline at end of file
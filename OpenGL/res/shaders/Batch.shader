@@ -0,0 +1,44 @@
+ /* Batched quad shader, one texture slot per sampler in u_Textures. */
+
+ #shader vertex
+ #version 420 core
+
+ layout(location = 0) in vec3 position;
+ layout(location = 1) in vec4 color;
+ layout(location = 2) in vec2 texCoord;
+ layout(location = 3) in float texIndex;
+
+ out vec4 v_Color;
+ out vec2 v_TexCoord;
+ out float v_TexIndex;
+
+ layout(std140, binding = 0) uniform Camera
+ {
+    mat4 u_ViewProjection;
+ };
+
+ void main()
+ {
+    gl_Position = u_ViewProjection * vec4(position, 1.0);
+    v_Color = color;
+    v_TexCoord = texCoord;
+    v_TexIndex = texIndex;
+ };
+
+
+ #shader fragment
+ #version 420 core
+
+ layout(location = 0) out vec4 color;
+
+ in vec4 v_Color;
+ in vec2 v_TexCoord;
+ in float v_TexIndex;
+
+ uniform sampler2D u_Textures[16];
+
+ void main()
+ {
+    int index = int(v_TexIndex);
+    color = texture(u_Textures[index], v_TexCoord) * v_Color;
+ };
@@ -0,0 +1,44 @@
+ /* Multi-draw indirect and instanced shader, each instance's model matrix comes from the DrawData storage buffer
+ at gl_BaseInstance + gl_InstanceID. Works with Renderer::FlushIndirect and with Renderer::Flush. */
+
+ #shader vertex
+ #version 450 core
+ /* Core in 4.6, gl_BaseInstance is gl_BaseInstanceARB before that. */
+ #extension GL_ARB_shader_draw_parameters : require
+
+ layout(location = 0) in vec4 position;
+ layout(location = 1) in vec2 texCoord;
+
+ out vec2 v_TexCoord;
+
+ layout(std140, binding = 0) uniform Camera
+ {
+    mat4 u_ViewProjection;
+ };
+
+ /* Filled by Renderer::Flush and FlushIndirect, one entry per queued command. */
+ layout(std430, binding = 0) readonly buffer DrawData
+ {
+    mat4 u_Models[];
+ };
+
+ void main()
+ {
+    gl_Position = u_ViewProjection * u_Models[gl_BaseInstanceARB + gl_InstanceID] * position;
+    v_TexCoord = texCoord;
+ };
+
+
+ #shader fragment
+ #version 450 core
+
+ layout(location = 0) out vec4 color;
+
+ in vec2 v_TexCoord;
+
+ uniform sampler2D u_Texture;
+
+ void main()
+ {
+    color = texture(u_Texture, v_TexCoord);
+ };
@@ -0,0 +1,36 @@
+ /* Instanced shader, the model matrix comes from a per-instance attribute. */
+
+ #shader vertex
+ #version 420 core
+
+ layout(location = 0) in vec4 position;
+ layout(location = 1) in vec2 texCoord;
+ layout(location = 2) in mat4 model;
+
+ out vec2 v_TexCoord;
+
+ layout(std140, binding = 0) uniform Camera
+ {
+    mat4 u_ViewProjection;
+ };
+
+ void main()
+ {
+    gl_Position = u_ViewProjection * model * position;
+    v_TexCoord = texCoord;
+ };
+
+
+ #shader fragment
+ #version 420 core
+
+ layout(location = 0) out vec4 color;
+
+ in vec2 v_TexCoord;
+
+ uniform sampler2D u_Texture;
+
+ void main()
+ {
+    color = texture(u_Texture, v_TexCoord);
+ };
@@ -0,0 +1,43 @@
+ /* Lit mesh shader, reads the MeshVertex and QuantizedVertex layouts. Quantized positions are
+ taken back to model space by the mesh's Dequantize matrix, folded into u_Model. */
+
+ #shader vertex
+ #version 420 core
+
+ layout(location = 0) in vec4 position;
+ layout(location = 1) in vec3 normal;
+ layout(location = 2) in vec2 texCoord;
+
+ out vec2 v_TexCoord;
+ out vec3 v_Normal;
+
+ layout(std140, binding = 0) uniform Camera
+ {
+    mat4 u_ViewProjection;
+ };
+ uniform mat4 u_Model;
+
+ void main()
+ {
+    gl_Position = u_ViewProjection * u_Model * position;
+    v_TexCoord = texCoord;
+    v_Normal = normal;
+ };
+
+
+ #shader fragment
+ #version 420 core
+
+ layout(location = 0) out vec4 color;
+
+ in vec2 v_TexCoord;
+ in vec3 v_Normal;
+
+ uniform sampler2D u_Texture;
+
+ void main()
+ {
+    /* Light from the camera, never fully dark. */
+    float light = max(normalize(v_Normal).z, 0.25);
+    color = texture(u_Texture, v_TexCoord) * vec4(vec3(light), 1.0);
+ };
@@ -13,6 +13,12 @@
 #include "VertexArray.h"
 #include "Shader.h"
 #include "Texture.h"
+#include "TextureLoader.h"
+#include "TextureAtlas.h"
+#include "TextureCache.h"
+#include "Benchmark.h"
+#include "GLState.h"
+#include "UniformBuffer.h"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -21,10 +27,36 @@
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/imgui_impl_opengl3.h"
 
-int main(void)
+int main(int argc, char** argv)
 {
     GLFWwindow* window;
 
+    /* --pack-atlas <output.atlas> <images...> packs the images offline and exits, no window needed. */
+    if (argc > 2 && std::string(argv[1]) == "--pack-atlas")
+    {
+        TextureAtlas atlas;
+        int failed = 0;
+        for (int i = 3; i < argc; i++)
+        {
+            if (!atlas.Add(argv[i], argv[i]))
+                failed++;
+        }
+
+        /* A partial atlas would be missing regions the game asks for, so nothing is written. */
+        if (failed > 0)
+        {
+            std::cout << failed << " of " << argc - 3 << " images could not be loaded, atlas not written" << std::endl;
+            return -1;
+        }
+
+        bool packed = atlas.Build() && atlas.Save(argv[2]);
+        std::cout << "Packed " << atlas.GetRegions().size() << " images into " << atlas.GetPageCount() << " pages" << std::endl;
+        return packed ? 0 : -1;
+    }
+
+    /* --benchmark runs the headless benchmarks in a hidden window and exits. */
+    bool benchmark = argc > 1 && std::string(argv[1]) == "--benchmark";
+
     /* Initialize the library */
     if (!glfwInit())
         return -1;
@@ -34,6 +66,14 @@ int main(void)
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
+#if GL_ERROR_CHECK == GL_ERROR_CHECK_CALLBACK
+    /* Debug output is only guaranteed on a debug context. */
+    glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+#endif
+
+    if (benchmark)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
     /* Create a windowed mode window and its OpenGL context */
     window = glfwCreateWindow(1280, 960, "Hello World", NULL, NULL);
     if (!window)
@@ -51,9 +91,33 @@ int main(void)
     if(glewInit() != GLEW_OK)
         std::cout << "glew init error" << std::endl;
 
+    GLInitDebugOutput();
+    Shader::EnableParallelCompile();
+
     /* Print openGl version */
     std::cout << glGetString(GL_VERSION) << std::endl;
 
+    if (benchmark)
+    {
+        /* Don't let vsync cap the measurements. */
+        glfwSwapInterval(0);
+        {
+            /* Every benchmark draws the same image, the handle held here keeps it loaded between them. */
+            TextureCache textures(64 * 1024 * 1024);
+            TextureCache::Handle skel = textures.Load("res/textures/skel.png");
+            RunQuadBenchmark(textures, 10000, 100);
+            RunInstancingBenchmark(textures, 100000, 10);
+            RunBufferUpdateBenchmark(textures, 100000, 16, 10);
+            RunUniformBenchmark(1000000);
+            RunMeshOptimizerBenchmark(textures, 250, 100);
+            std::cout << "Texture cache: " << textures.GetStats().Hits << " hits, " << textures.GetStats().Misses
+                << " misses, " << textures.GetStats().ResidentBytes << " bytes resident" << std::endl;
+        }
+
+        glfwTerminate();
+        return 0;
+    }
+
     /* Drawing square counter-clockwise. */
     {
         float positions[] = {
@@ -69,8 +133,8 @@ int main(void)
             2, 3, 0
         };
 
-        GLCall(glEnable(GL_BLEND));
-        GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+        GLState::SetBlend(true);
+        GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         
         
         /* Buffer gets bound in constructor so vb.bind() doesn't need to be called. */
@@ -93,12 +157,40 @@ int main(void)
         Shader shader("res/shaders/Basic.shader");
         shader.Bind();
 
-        shader.SetUniform4f("u_Color", 0.5, 0.0, 0.5, 1.0);
-
-        Texture texture("res/textures/skel.png");
-        texture.Bind();
+        /* Camera block, written once per frame and read by every shader from its fixed binding point. */
+        Std140Layout cameraLayout;
+        cameraLayout.Push<glm::mat4>();
+        UniformBuffer camera(cameraLayout.GetSize());
+        camera.Bind(UniformBinding::Camera);
+
+        /* Material blocks are suballocated from one buffer, a draw picks its block with BindRange. */
+        Std140Layout materialLayout;
+        unsigned int colorOffset = materialLayout.Push<glm::vec4>();
+        UniformBuffer materials(4096);
+        unsigned int material = materials.Allocate(materialLayout.GetSize());
+        /* White leaves the texture colors as they are. */
+        glm::vec4 tint(1.0f);
+        materials.SetData(&tint[0], sizeof(glm::vec4), material + colorOffset);
+        materials.BindRange(UniformBinding::Material, material, materialLayout.GetSize());
+
+        /* Decoded in the background, the quad shows a placeholder until the upload is done. */
+        TextureLoader textureLoader;
+        std::shared_ptr<Texture> texture = textureLoader.Load("res/textures/skel.png");
+        /* Kept when the real image replaces the placeholder. */
+        texture->SetFilter(TextureFilter::Trilinear, 8.0f);
+        texture->Bind();
         shader.SetUniform1i("u_Texture", 0);
+
+        /* Cache numbers are only final once every shader has linked. */
+        shader.WaitUntilReady();
+        const ShaderCacheStats& cacheStats = Shader::GetCacheStats();
+        std::cout << "Shader cache: " << cacheStats.Hits << " hits, " << cacheStats.Misses << " misses ("
+            << cacheStats.Rejected << " rejected), submit to ready " << cacheStats.CompileMilliseconds << " ms, load "
+            << cacheStats.LoadMilliseconds << " ms, saved " << cacheStats.SavedMilliseconds << " ms" << std::endl;
         
+        /* Looked up once, the frame loop sets uniforms through the handle. */
+        int modelHandle = shader.GetUniformHandle("u_Model");
+
         Renderer renderer;
 
         IMGUI_CHECKVERSION();
@@ -120,34 +212,57 @@ int main(void)
         /* Loop until user closes window.*/
         while (!glfwWindowShouldClose(window))
         {
+            /* Counters of the previous frame, shown in the ImGui window. */
+            GLState::Stats stateStats = GLState::GetStats();
+            GLState::ResetStats();
+            Renderer::QueueStats queueStats = renderer.GetQueueStats();
+            renderer.ResetQueueStats();
+            UniformStats uniformStats = Shader::GetUniformStats();
+            Shader::ResetUniformStats();
+
             /* Render here */
             renderer.Clear();
 
+            /* Upload finished decodes, bounded so a burst of loads doesn't stall the frame. */
+            textureLoader.Update(2.0);
+
             ImGui_ImplOpenGL3_NewFrame();
             ImGui_ImplGlfw_NewFrame();
             ImGui::NewFrame();
 
             glm::mat4 model = glm::translate(glm::mat4(1.0f), translation);
-            /* Resulting matrix which represent all the positioning in our scene.
+            /* Resulting matrix which represent the camera part of the positioning in our scene, the shader applies the model.
             Multiplication order is dependant on how the matrix data is stored in different frameworks. */
-            glm::mat4 mvp = proj * view * model;
+            glm::mat4 viewProjection = proj * view;
+            camera.SetData(&viewProjection[0][0], sizeof(glm::mat4));
 
-            shader.SetUniform4f("u_Color", 0.5, 0.0, 0.5, 1.0);
-            shader.SetUniformMat4f("u_MVP", mvp);
+            shader.SetUniformMat4f(modelHandle, model);
 
-            GLCall(glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr));
+            /* Creating the buffers doesn't bind anything with direct state access, so bind before the raw draw. */
+            va.Bind();
+            ib.Bind();
+            GLCall(glDrawElements(GL_TRIANGLES, 6, ib.GetType(), nullptr));
 
-            renderer.Draw(va, ib, shader);
+            renderer.Submit(va, ib, shader, model, texture.get());
+            renderer.Flush();
 
 
             // ImGui Window.
             {
                 ImGui::SliderFloat3("Translation", &translation.x, 0.0f, 4.0f);            
                 ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+                ImGui::Text("GL state calls: %u issued, %u skipped", stateStats.Issued, stateStats.Skipped);
+                ImGui::Text("Render queue: %u commands, %u draw calls, %u program / %u texture changes",
+                    queueStats.Commands, queueStats.DrawCalls, queueStats.ProgramChanges, queueStats.TextureChanges);
+                ImGui::Text("Uniforms: %u uploaded, %u skipped", uniformStats.Uploaded, uniformStats.Skipped);
+                ImGui::Text("Textures: %u pending, %u uploaded, %u failed", textureLoader.GetStats().Pending,
+                    textureLoader.GetStats().Uploaded, textureLoader.GetStats().Failed);
             }
 
             ImGui::Render();
             ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            /* ImGui binds its own state behind the cache's back. */
+            GLState::Invalidate();
 
             /* Swap front and back buffers */
             GLCall(glfwSwapBuffers(window));
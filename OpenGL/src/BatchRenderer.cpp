@@ -0,0 +1,205 @@
+#include "BatchRenderer.h"
+#include "TextureAtlas.h"
+#include "VertexBufferLayout.h"
+#include "GLState.h"
+
+/* Strides and offsets come straight from QuadVertex, so the struct and the layout can't drift apart. */
+static constexpr auto s_QuadVertexLayout = MakeVertexLayout<QuadVertex>(
+	VERTEX_ATTRIBUTE(QuadVertex, Position),
+	VERTEX_ATTRIBUTE(QuadVertex, Color),
+	VERTEX_ATTRIBUTE(QuadVertex, TexCoord),
+	VERTEX_ATTRIBUTE(QuadVertex, TexIndex));
+
+BatchRenderer::BatchRenderer(Shader& shader, unsigned int maxQuads)
+	:m_Shader(shader), m_MaxQuads(maxQuads), m_Vertices(nullptr), m_BaseVertex(0), m_QuadCount(0),
+	m_WhiteTexture(0), m_TextureSlotIndex(1)
+{
+	unsigned int batchSize = m_MaxQuads * 4 * (unsigned int)sizeof(QuadVertex);
+
+	/* Vertex array has to be bound before the buffers so they get attached to it. */
+	m_VertexArray.Bind();
+	if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage)
+	{
+		m_StreamingBuffer = std::make_unique<StreamingVertexBuffer>(batchSize);
+		m_VertexArray.AddBuffer(*m_StreamingBuffer, s_QuadVertexLayout);
+	}
+	else
+	{
+		m_Staging.resize(m_MaxQuads * 4);
+		m_Vertices = m_Staging.data();
+		m_VertexBuffer = std::make_unique<VertexBuffer>(batchSize, BufferUsage::Stream);
+		m_VertexArray.AddBuffer(*m_VertexBuffer, s_QuadVertexLayout);
+	}
+
+	/* Every quad uses the same index pattern, so the index buffer is generated once up front. */
+	std::vector<unsigned int> indices(m_MaxQuads * 6);
+	unsigned int offset = 0;
+	for (unsigned int i = 0; i < indices.size(); i += 6)
+	{
+		indices[i + 0] = offset + 0;
+		indices[i + 1] = offset + 1;
+		indices[i + 2] = offset + 2;
+
+		indices[i + 3] = offset + 2;
+		indices[i + 4] = offset + 3;
+		indices[i + 5] = offset + 0;
+
+		offset += 4;
+	}
+	m_IndexBuffer = std::make_unique<IndexBuffer>(indices.data(), (unsigned int)indices.size());
+
+	unsigned int white = 0xffffffff;
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &m_WhiteTexture));
+		GLCall(glTextureParameteri(m_WhiteTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+		GLCall(glTextureParameteri(m_WhiteTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+		GLCall(glTextureStorage2D(m_WhiteTexture, 1, GL_RGBA8, 1, 1));
+		GLCall(glTextureSubImage2D(m_WhiteTexture, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &white));
+	}
+	else
+	{
+		GLCall(glGenTextures(1, &m_WhiteTexture));
+		GLState::BindTexture(0, GL_TEXTURE_2D, m_WhiteTexture);
+		GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+		GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+		GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &white));
+		GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+	}
+
+	m_TextureSlots.fill(0);
+	m_TextureSlots[0] = m_WhiteTexture;
+
+	int samplers[MaxTextureSlots];
+	for (int i = 0; i < (int)MaxTextureSlots; i++)
+		samplers[i] = i;
+
+	m_Shader.Bind();
+	m_Shader.SetUniform1iv("u_Textures", MaxTextureSlots, samplers);
+
+	/* Quads submitted before the first BeginBatch need a region too. */
+	BeginBatch();
+}
+
+BatchRenderer::~BatchRenderer()
+{
+	GLState::ForgetTexture(m_WhiteTexture);
+	GLCall(glDeleteTextures(1, &m_WhiteTexture));
+}
+
+void BatchRenderer::BeginBatch()
+{
+	m_QuadCount = 0;
+	m_TextureSlotIndex = 1;
+
+	if (m_StreamingBuffer)
+	{
+		m_StreamingBuffer->BeginFrame();
+		unsigned int offset;
+		m_Vertices = (QuadVertex*)m_StreamingBuffer->Allocate(m_StreamingBuffer->GetRegionSize(), sizeof(QuadVertex), offset);
+		m_BaseVertex = (int)(offset / sizeof(QuadVertex));
+	}
+}
+
+void BatchRenderer::EndBatch()
+{
+	/* Streamed quads are already in the buffer. */
+	if (m_QuadCount == 0 || m_StreamingBuffer)
+		return;
+
+	m_VertexBuffer->SetData(m_Staging.data(), m_QuadCount * 4 * (unsigned int)sizeof(QuadVertex));
+}
+
+void BatchRenderer::Flush()
+{
+	if (m_QuadCount == 0)
+		return;
+
+	for (unsigned int i = 0; i < m_TextureSlotIndex; i++)
+		GLState::BindTexture(i, GL_TEXTURE_2D, m_TextureSlots[i]);
+
+	m_Renderer.Draw(m_VertexArray, *m_IndexBuffer, m_Shader, m_QuadCount * 6, m_BaseVertex);
+	if (m_StreamingBuffer)
+		m_StreamingBuffer->EndFrame();
+
+	m_Stats.DrawCalls++;
+	m_Stats.QuadCount += m_QuadCount;
+}
+
+void BatchRenderer::SubmitQuad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color)
+{
+	if (m_QuadCount >= m_MaxQuads)
+	{
+		EndBatch();
+		Flush();
+		BeginBatch();
+	}
+
+	PushQuad(position, size, color, 0.0f);
+}
+
+void BatchRenderer::SubmitQuad(const glm::vec2& position, const glm::vec2& size, const Texture& texture, const glm::vec4& tint)
+{
+	if (m_QuadCount >= m_MaxQuads)
+	{
+		EndBatch();
+		Flush();
+		BeginBatch();
+	}
+
+	/* Lookup can flush the batch when every slot is taken, so it has to happen before the quad is written. */
+	float texIndex = GetTextureIndex(texture.GetRendererID());
+	PushQuad(position, size, tint, texIndex);
+}
+
+void BatchRenderer::SubmitQuad(const glm::vec2& position, const glm::vec2& size, const Texture& texture,
+	const glm::vec2& uvMin, const glm::vec2& uvMax, const glm::vec4& tint)
+{
+	if (m_QuadCount >= m_MaxQuads)
+	{
+		EndBatch();
+		Flush();
+		BeginBatch();
+	}
+
+	float texIndex = GetTextureIndex(texture.GetRendererID());
+	PushQuad(position, size, tint, texIndex, uvMin, uvMax);
+}
+
+void BatchRenderer::SubmitQuad(const glm::vec2& position, const glm::vec2& size, const TextureAtlas& atlas,
+	const AtlasRegion& region, const glm::vec4& tint)
+{
+	SubmitQuad(position, size, atlas.GetPageTexture(region.Page), region.UVMin, region.UVMax, tint);
+}
+
+float BatchRenderer::GetTextureIndex(unsigned int textureID)
+{
+	for (unsigned int i = 1; i < m_TextureSlotIndex; i++)
+	{
+		if (m_TextureSlots[i] == textureID)
+			return (float)i;
+	}
+
+	if (m_TextureSlotIndex >= MaxTextureSlots)
+	{
+		EndBatch();
+		Flush();
+		BeginBatch();
+	}
+
+	m_TextureSlots[m_TextureSlotIndex] = textureID;
+	return (float)m_TextureSlotIndex++;
+}
+
+void BatchRenderer::PushQuad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color, float texIndex,
+	const glm::vec2& uvMin, const glm::vec2& uvMax)
+{
+	QuadVertex* v = &m_Vertices[m_QuadCount * 4];
+
+	v[0] = { { position.x,          position.y,          0.0f }, color, { uvMin.x, uvMin.y }, texIndex };
+	v[1] = { { position.x + size.x, position.y,          0.0f }, color, { uvMax.x, uvMin.y }, texIndex };
+	v[2] = { { position.x + size.x, position.y + size.y, 0.0f }, color, { uvMax.x, uvMax.y }, texIndex };
+	v[3] = { { position.x,          position.y + size.y, 0.0f }, color, { uvMin.x, uvMax.y }, texIndex };
+
+	m_QuadCount++;
+}
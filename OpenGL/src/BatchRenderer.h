@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "Renderer.h"
+#include "VertexBuffer.h"
+#include "Texture.h"
+
+class TextureAtlas;
+struct AtlasRegion;
+
+#include "glm/glm.hpp"
+
+/* Layout of a single vertex in the batch vertex buffer. */
+struct QuadVertex
+{
+	glm::vec3 Position;
+	glm::vec4 Color;
+	glm::vec2 TexCoord;
+	float TexIndex;
+};
+
+/* Accumulates quads into one dynamic vertex buffer and draws them with as few draw calls as possible.
+A batch is only flushed early when the vertex buffer or the texture slots run out.
+With persistent mapping (GL 4.4) quads are written straight into a StreamingVertexBuffer, every batch takes
+the next of its regions so the CPU fills one while the GPU still draws the previous ones. */
+class BatchRenderer
+{
+public:
+	/* Must match the size of the u_Textures array in Batch.shader. */
+	static const unsigned int MaxTextureSlots = 16;
+
+	struct Stats
+	{
+		unsigned int DrawCalls = 0;
+		unsigned int QuadCount = 0;
+	};
+
+private:
+	Shader& m_Shader;
+	Renderer m_Renderer;
+	unsigned int m_MaxQuads;
+
+	VertexArray m_VertexArray;
+	/* Only one of the two vertex buffers exists. */
+	std::unique_ptr<StreamingVertexBuffer> m_StreamingBuffer;
+	std::unique_ptr<VertexBuffer> m_VertexBuffer;
+	std::unique_ptr<IndexBuffer> m_IndexBuffer;
+
+	/* CPU side copy of the batch, uploaded in one go by EndBatch. Unused when streaming. */
+	std::vector<QuadVertex> m_Staging;
+	/* Where the next quads are written, into m_Staging or the mapped region of the current batch. */
+	QuadVertex* m_Vertices;
+	/* First vertex of the current batch in the vertex buffer. */
+	int m_BaseVertex;
+	unsigned int m_QuadCount;
+
+	/* Slot 0 always holds a 1x1 white texture so untextured quads share the batch. */
+	unsigned int m_WhiteTexture;
+	std::array<unsigned int, MaxTextureSlots> m_TextureSlots;
+	unsigned int m_TextureSlotIndex;
+
+	Stats m_Stats;
+
+	float GetTextureIndex(unsigned int textureID);
+	void PushQuad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color, float texIndex,
+		const glm::vec2& uvMin = glm::vec2(0.0f), const glm::vec2& uvMax = glm::vec2(1.0f));
+
+public:
+	/* Shader is expected to be Batch.shader or share its attribute and sampler layout. */
+	BatchRenderer(Shader& shader, unsigned int maxQuads = 10000);
+	~BatchRenderer();
+
+	/* When streaming, waits for the GPU if it still reads the region this batch is about to reuse. */
+	void BeginBatch();
+	/* Uploads the accumulated vertices, call before Flush. */
+	void EndBatch();
+	/* Issues a single draw call for everything submitted since BeginBatch. */
+	void Flush();
+
+	void SubmitQuad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color);
+	void SubmitQuad(const glm::vec2& position, const glm::vec2& size, const Texture& texture, const glm::vec4& tint = glm::vec4(1.0f));
+	/* Draws only the uvMin to uvMax part of texture. */
+	void SubmitQuad(const glm::vec2& position, const glm::vec2& size, const Texture& texture,
+		const glm::vec2& uvMin, const glm::vec2& uvMax, const glm::vec4& tint = glm::vec4(1.0f));
+	/* Draws an atlas region, regions on the same page share a texture slot. */
+	void SubmitQuad(const glm::vec2& position, const glm::vec2& size, const TextureAtlas& atlas,
+		const AtlasRegion& region, const glm::vec4& tint = glm::vec4(1.0f));
+
+	inline const Stats& GetStats() const { return m_Stats; }
+	inline bool IsStreaming() const { return m_StreamingBuffer != nullptr; }
+	inline void ResetStats() { m_Stats = Stats(); }
+};
@@ -0,0 +1,610 @@
+#include "Benchmark.h"
+#include "Renderer.h"
+#include "BatchRenderer.h"
+#include "GeometryArena.h"
+#include "MeshOptimizer.h"
+#include "MeshQuantizer.h"
+#include "VertexBuffer.h"
+#include "VertexBufferLayout.h"
+#include "VertexArrayCache.h"
+#include "Texture.h"
+#include "TextureCache.h"
+#include "UniformBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "glm/gtc/matrix_transform.hpp"
+
+/* Runs func frames times and returns the elapsed seconds, waiting for the GPU to finish. */
+template<typename Func>
+static double TimeFrames(unsigned int frames, Func func)
+{
+    GLCall(glFinish());
+    auto start = std::chrono::high_resolution_clock::now();
+
+    for (unsigned int i = 0; i < frames; i++)
+        func();
+
+    GLCall(glFinish());
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/* Every benchmark shader reads the camera block, Basic.shader also needs a material. */
+static void SetupUniformBlocks(UniformBuffer& camera, UniformBuffer& material, const glm::mat4& viewProjection)
+{
+    glm::vec4 white(1.0f);
+    camera.SetData(&viewProjection[0][0], sizeof(glm::mat4));
+    material.SetData(&white[0], sizeof(glm::vec4));
+    camera.Bind(UniformBinding::Camera);
+    material.Bind(UniformBinding::Material);
+}
+
+static void PrintResult(const char* name, unsigned int quadCount, unsigned int frames, double seconds)
+{
+    double quadsPerSecond = (double)quadCount * frames / seconds;
+    std::cout << name << ": " << seconds * 1000.0 / frames << " ms/frame, "
+        << (unsigned long long)quadsPerSecond << " quads/s" << std::endl;
+}
+
+void RunQuadBenchmark(TextureCache& textures, unsigned int quadCount, unsigned int frames)
+{
+    std::cout << "Quad benchmark: " << quadCount << " quads, " << frames << " frames" << std::endl;
+
+    glm::mat4 proj = glm::ortho(-2.0f, 2.0f, -1.50f, 1.50f, -0.5f, 0.5f);
+    UniformBuffer camera(sizeof(glm::mat4));
+    UniformBuffer material(sizeof(glm::vec4));
+    SetupUniformBlocks(camera, material, proj);
+    TextureCache::Handle skel = textures.Load("res/textures/skel.png");
+    Texture& texture = skel.Get();
+    Renderer renderer;
+
+    /* Quads are laid out on a grid so both paths draw the same scene. */
+    unsigned int columns = 1;
+    while (columns * columns < quadCount)
+        columns++;
+    float quadSize = 4.0f / columns;
+
+    /* Per-object path: every quad owns its buffers and costs one Renderer::Draw. */
+    {
+        float positions[] = {
+            0.0f, 0.0f, 0.0f, 0.0f,
+            1.0f, 0.0f, 1.0f, 0.0f,
+            1.0f, 1.0f, 1.0f, 1.0f,
+            0.0f, 1.0f, 0.0f, 1.0f,
+        };
+        unsigned int indices[] = { 0, 1, 2, 2, 3, 0 };
+
+        VertexBufferLayout layout;
+        layout.Push<float>(2);
+        layout.Push<float>(2);
+
+        /* Stored by value, the resources are move only so growing the vectors is safe. */
+        std::vector<VertexArray> vertexArrays;
+        std::vector<VertexBuffer> vertexBuffers;
+        std::vector<IndexBuffer> indexBuffers;
+        std::vector<glm::mat4> models;
+        vertexArrays.reserve(quadCount);
+        vertexBuffers.reserve(quadCount);
+        indexBuffers.reserve(quadCount);
+        for (unsigned int i = 0; i < quadCount; i++)
+        {
+            vertexArrays.emplace_back();
+            vertexArrays.back().Bind();
+            vertexBuffers.emplace_back(positions, (unsigned int)sizeof(positions));
+            vertexArrays.back().AddBuffer(vertexBuffers.back(), layout);
+            indexBuffers.emplace_back(indices, 6);
+
+            glm::vec3 position(-2.0f + (i % columns) * quadSize, -1.5f + (i / columns) * quadSize, 0.0f);
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+            models.push_back(glm::scale(model, glm::vec3(quadSize)));
+        }
+
+        Shader shader("res/shaders/Basic.shader");
+        shader.Bind();
+        texture.Bind();
+        shader.SetUniform1i("u_Texture", 0);
+
+        double seconds = TimeFrames(frames, [&]()
+        {
+            renderer.Clear();
+            for (unsigned int i = 0; i < quadCount; i++)
+            {
+                shader.SetUniformMat4f("u_Model", models[i]);
+                renderer.Draw(vertexArrays[i], indexBuffers[i], shader);
+            }
+        });
+        PrintResult("Renderer::Draw", quadCount, frames, seconds);
+
+        /* Same buffers through the cache, every quad has the same layout so attribute binding shares one vertex array. */
+        VertexArrayCache vertexArrayCache;
+        seconds = TimeFrames(frames, [&]()
+        {
+            renderer.Clear();
+            for (unsigned int i = 0; i < quadCount; i++)
+            {
+                shader.SetUniformMat4f("u_Model", models[i]);
+                const VertexArray& va = vertexArrayCache.Bind(vertexBuffers[i], layout, indexBuffers[i]);
+                renderer.Draw(va, indexBuffers[i], shader);
+            }
+        });
+        PrintResult("Renderer::Draw cached vertex arrays", quadCount, frames, seconds);
+        std::cout << "Vertex array cache: " << vertexArrayCache.GetStats().VertexArrays << " vertex arrays, "
+            << vertexArrayCache.GetStats().BufferSwaps / frames << " buffer swaps per frame" << std::endl;
+    }
+
+    /* Batched path: all quads go through one shared dynamic buffer. */
+    {
+        Shader shader("res/shaders/Batch.shader");
+        BatchRenderer batch(shader);
+
+        double seconds = TimeFrames(frames, [&]()
+        {
+            renderer.Clear();
+            batch.BeginBatch();
+            for (unsigned int i = 0; i < quadCount; i++)
+            {
+                glm::vec2 position(-2.0f + (i % columns) * quadSize, -1.5f + (i / columns) * quadSize);
+                batch.SubmitQuad(position, glm::vec2(quadSize), texture);
+            }
+            batch.EndBatch();
+            batch.Flush();
+        });
+        PrintResult("BatchRenderer", quadCount, frames, seconds);
+        std::cout << "BatchRenderer draw calls per frame: " << batch.GetStats().DrawCalls / frames << std::endl;
+    }
+
+    /* Static scene path: every quad is its own mesh in a shared arena, queued with its own model matrix.
+    Flush needs a draw call per quad since the matrices differ, FlushIndirect reads them from a storage buffer. */
+    {
+        float positions[] = {
+            0.0f, 0.0f, 0.0f, 0.0f,
+            1.0f, 0.0f, 1.0f, 0.0f,
+            1.0f, 1.0f, 1.0f, 1.0f,
+            0.0f, 1.0f, 0.0f, 1.0f,
+        };
+        unsigned int indices[] = { 0, 1, 2, 2, 3, 0 };
+
+        VertexBufferLayout layout;
+        layout.Push<float>(2);
+        layout.Push<float>(2);
+        GeometryArena arena(layout, quadCount * 4, quadCount * 6);
+
+        std::vector<GeometryArena::MeshHandle> meshes;
+        std::vector<glm::mat4> models;
+        for (unsigned int i = 0; i < quadCount; i++)
+        {
+            meshes.push_back(arena.Allocate(positions, 4, indices, 6));
+            glm::vec3 position(-2.0f + (i % columns) * quadSize, -1.5f + (i / columns) * quadSize, 0.0f);
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+            models.push_back(glm::scale(model, glm::vec3(quadSize)));
+        }
+
+        Shader shader("res/shaders/Basic.shader");
+        shader.Bind();
+        shader.SetUniform1i("u_Texture", 0);
+        Shader indirectShader("res/shaders/Indirect.shader");
+        indirectShader.Bind();
+        indirectShader.SetUniform1i("u_Texture", 0);
+
+        renderer.ResetQueueStats();
+        double seconds = TimeFrames(frames, [&]()
+        {
+            renderer.Clear();
+            for (unsigned int i = 0; i < quadCount; i++)
+                renderer.Submit(arena.MakeCommand(meshes[i], shader, models[i], &texture));
+            renderer.Flush();
+        });
+        PrintResult("Renderer::Flush", quadCount, frames, seconds);
+        std::cout << "Renderer::Flush draw calls per frame: " << renderer.GetQueueStats().DrawCalls / frames << std::endl;
+
+        renderer.ResetQueueStats();
+        seconds = TimeFrames(frames, [&]()
+        {
+            renderer.Clear();
+            for (unsigned int i = 0; i < quadCount; i++)
+                renderer.Submit(arena.MakeCommand(meshes[i], indirectShader, models[i], &texture));
+            renderer.FlushIndirect();
+        });
+        PrintResult("Renderer::FlushIndirect", quadCount, frames, seconds);
+        std::cout << "Renderer::FlushIndirect draw calls per frame: " << renderer.GetQueueStats().DrawCalls / frames << std::endl;
+
+        /* Same mesh everywhere: Flush turns the run into one instanced draw when the shader reads DrawData. */
+        renderer.ResetQueueStats();
+        seconds = TimeFrames(frames, [&]()
+        {
+            renderer.Clear();
+            for (unsigned int i = 0; i < quadCount; i++)
+                renderer.Submit(arena.MakeCommand(meshes[0], indirectShader, models[i], &texture));
+            renderer.Flush();
+        });
+        PrintResult("Renderer::Flush instanced", quadCount, frames, seconds);
+        std::cout << "Renderer::Flush instanced draw calls per frame: " << renderer.GetQueueStats().DrawCalls / frames << std::endl;
+    }
+}
+
+void RunInstancingBenchmark(TextureCache& textures, unsigned int instanceCount, unsigned int frames)
+{
+    std::cout << "Instancing benchmark: " << instanceCount << " instances, " << frames << " frames" << std::endl;
+
+    glm::mat4 proj = glm::ortho(-2.0f, 2.0f, -1.50f, 1.50f, -0.5f, 0.5f);
+    UniformBuffer camera(sizeof(glm::mat4));
+    UniformBuffer material(sizeof(glm::vec4));
+    SetupUniformBlocks(camera, material, proj);
+    TextureCache::Handle skel = textures.Load("res/textures/skel.png");
+    Texture& texture = skel.Get();
+    texture.Bind();
+    Renderer renderer;
+
+    float positions[] = {
+        0.0f, 0.0f, 0.0f, 0.0f,
+        1.0f, 0.0f, 1.0f, 0.0f,
+        1.0f, 1.0f, 1.0f, 1.0f,
+        0.0f, 1.0f, 0.0f, 1.0f,
+    };
+    unsigned int indices[] = { 0, 1, 2, 2, 3, 0 };
+
+    unsigned int columns = 1;
+    while (columns * columns < instanceCount)
+        columns++;
+    float quadSize = 4.0f / columns;
+
+    std::vector<glm::mat4> models(instanceCount);
+    for (unsigned int i = 0; i < instanceCount; i++)
+    {
+        glm::vec3 position(-2.0f + (i % columns) * quadSize, -1.5f + (i / columns) * quadSize, 0.0f);
+        models[i] = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(quadSize));
+    }
+
+    VertexArray va;
+    va.Bind();
+    VertexBuffer vb(positions, (unsigned int)sizeof(positions));
+    VertexBufferLayout layout;
+    layout.Push<float>(2);
+    layout.Push<float>(2);
+    va.AddBuffer(vb, layout);
+
+    VertexBuffer instances(models.data(), instanceCount * (unsigned int)sizeof(glm::mat4));
+    VertexBufferLayout instanceLayout;
+    instanceLayout.Push<glm::mat4>(1, 1);
+    va.AddBuffer(instances, instanceLayout);
+
+    IndexBuffer ib(indices, 6);
+
+    {
+        Shader shader("res/shaders/Basic.shader");
+        shader.Bind();
+        shader.SetUniform1i("u_Texture", 0);
+
+        double seconds = TimeFrames(frames, [&]()
+        {
+            renderer.Clear();
+            for (unsigned int i = 0; i < instanceCount; i++)
+            {
+                shader.SetUniformMat4f("u_Model", models[i]);
+                renderer.Draw(va, ib, shader);
+            }
+        });
+        PrintResult("SetUniformMat4f + Draw", instanceCount, frames, seconds);
+    }
+
+    {
+        Shader shader("res/shaders/Instanced.shader");
+        shader.Bind();
+        shader.SetUniform1i("u_Texture", 0);
+
+        double seconds = TimeFrames(frames, [&]()
+        {
+            renderer.Clear();
+            renderer.DrawInstanced(va, ib, shader, instanceCount);
+        });
+        PrintResult("DrawInstanced", instanceCount, frames, seconds);
+    }
+}
+
+void RunBufferUpdateBenchmark(TextureCache& textures, unsigned int instanceCount, unsigned int updateStride, unsigned int frames)
+{
+    std::cout << "Buffer update benchmark: " << instanceCount << " instances, every " << updateStride
+        << "th moved per frame, " << frames << " frames" << std::endl;
+
+    glm::mat4 proj = glm::ortho(-2.0f, 2.0f, -1.50f, 1.50f, -0.5f, 0.5f);
+    UniformBuffer camera(sizeof(glm::mat4));
+    UniformBuffer material(sizeof(glm::vec4));
+    SetupUniformBlocks(camera, material, proj);
+    TextureCache::Handle skel = textures.Load("res/textures/skel.png");
+    Texture& texture = skel.Get();
+    texture.Bind();
+    Renderer renderer;
+
+    float positions[] = {
+        0.0f, 0.0f, 0.0f, 0.0f,
+        1.0f, 0.0f, 1.0f, 0.0f,
+        1.0f, 1.0f, 1.0f, 1.0f,
+        0.0f, 1.0f, 0.0f, 1.0f,
+    };
+    unsigned int indices[] = { 0, 1, 2, 2, 3, 0 };
+
+    unsigned int columns = 1;
+    while (columns * columns < instanceCount)
+        columns++;
+    float quadSize = 4.0f / columns;
+
+    std::vector<glm::mat4> models(instanceCount);
+    for (unsigned int i = 0; i < instanceCount; i++)
+    {
+        glm::vec3 position(-2.0f + (i % columns) * quadSize, -1.5f + (i / columns) * quadSize, 0.0f);
+        models[i] = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(quadSize));
+    }
+
+    VertexBuffer quad(positions, (unsigned int)sizeof(positions));
+    VertexBufferLayout layout;
+    layout.Push<float>(2);
+    layout.Push<float>(2);
+    VertexBufferLayout instanceLayout;
+    instanceLayout.Push<glm::mat4>(1, 1);
+    IndexBuffer ib(indices, 6);
+
+    Shader shader("res/shaders/Instanced.shader");
+    shader.Bind();
+    shader.SetUniform1i("u_Texture", 0);
+
+    /* SetSubData uploads every write on the spot. Queued writes into a static buffer only merge when they
+    touch, a dynamic buffer keeps a copy of its contents and merges across the gaps between moved instances. */
+    const char* names[] = { "SetSubData", "QueueSubData, static buffer", "QueueSubData, dynamic buffer" };
+    for (int mode = 0; mode < 3; mode++)
+    {
+        VertexArray va;
+        va.Bind();
+        va.AddBuffer(quad, layout);
+        VertexBuffer instances(models.data(), instanceCount * (unsigned int)sizeof(glm::mat4),
+            mode == 2 ? BufferUsage::Dynamic : BufferUsage::Static);
+        va.AddBuffer(instances, instanceLayout);
+
+        unsigned int frame = 0;
+        unsigned long long uploads = 0;
+        double seconds = TimeFrames(frames, [&]()
+        {
+            float offset = (frame++ % 2 == 0 ? 0.01f : -0.01f);
+            for (unsigned int i = 0; i < instanceCount; i += updateStride)
+            {
+                models[i][3][0] += offset;
+                unsigned int byteOffset = i * (unsigned int)sizeof(glm::mat4);
+                if (mode == 0)
+                {
+                    instances.SetSubData(&models[i], sizeof(glm::mat4), byteOffset);
+                    uploads++;
+                }
+                else
+                    instances.QueueSubData(&models[i], sizeof(glm::mat4), byteOffset);
+            }
+            if (mode != 0)
+                uploads += instances.FlushUpdates();
+
+            renderer.Clear();
+            renderer.DrawInstanced(va, ib, shader, instanceCount);
+        });
+        std::cout << names[mode] << ": " << seconds * 1000.0 / frames << " ms/frame, "
+            << (double)uploads / frames << " uploads/frame" << std::endl;
+    }
+}
+
+/* Location lookup as Shader did it before reflection: hash a std::string per call, find then operator[]. */
+static int GetLocationByString(std::unordered_map<std::string, int>& cache, unsigned int program, const std::string& name)
+{
+    if (cache.find(name) != cache.end())
+        return cache[name];
+
+    int location = glGetUniformLocation(program, name.c_str());
+    cache[name] = location;
+    return location;
+}
+
+static void PrintCallRate(const char* name, unsigned int callCount, double seconds)
+{
+    std::cout << name << ": " << seconds * 1e9 / callCount << " ns/call, "
+        << (unsigned long long)(callCount / seconds) << " calls/s" << std::endl;
+}
+
+void RunUniformBenchmark(unsigned int callCount)
+{
+    std::cout << "Uniform benchmark: " << callCount << " SetUniformMat4f calls" << std::endl;
+
+    Shader shader("res/shaders/Basic.shader");
+    shader.Bind();
+    unsigned int program = shader.GetRendererID();
+    glm::mat4 matrix(1.0f);
+
+    {
+        std::unordered_map<std::string, int> cache;
+        double seconds = TimeFrames(1, [&]()
+        {
+            for (unsigned int i = 0; i < callCount; i++)
+            {
+                matrix[3][0] = (float)i;
+                glUniformMatrix4fv(GetLocationByString(cache, program, "u_Model"), 1, GL_FALSE, &matrix[0][0]);
+            }
+        });
+        PrintCallRate("std::string lookup", callCount, seconds);
+    }
+
+    {
+        static constexpr UniformName modelName("u_Model");
+        double seconds = TimeFrames(1, [&]()
+        {
+            for (unsigned int i = 0; i < callCount; i++)
+            {
+                /* Changing value so the dirty tracking can't skip the upload. */
+                matrix[3][0] = (float)i;
+                shader.SetUniformMat4f(modelName, matrix);
+            }
+        });
+        PrintCallRate("UniformName", callCount, seconds);
+    }
+
+    {
+        int handle = shader.GetUniformHandle("u_Model");
+        double seconds = TimeFrames(1, [&]()
+        {
+            for (unsigned int i = 0; i < callCount; i++)
+            {
+                matrix[3][0] = (float)i;
+                shader.SetUniformMat4f(handle, matrix);
+            }
+        });
+        PrintCallRate("Handle", callCount, seconds);
+
+        /* Same value every call, the shadow copy turns each call into a memcmp. */
+        seconds = TimeFrames(1, [&]()
+        {
+            for (unsigned int i = 0; i < callCount; i++)
+                shader.SetUniformMat4f(handle, matrix);
+        });
+        PrintCallRate("Handle, unchanged value", callCount, seconds);
+    }
+}
+
+static const char* GetIndexTypeName(unsigned int type)
+{
+    switch (type)
+    {
+        case GL_UNSIGNED_BYTE:  return "8 bit";
+        case GL_UNSIGNED_SHORT: return "16 bit";
+        default:                return "32 bit";
+    }
+}
+
+void RunMeshOptimizerBenchmark(TextureCache& textures, unsigned int gridSize, unsigned int frames)
+{
+    std::cout << "Mesh optimizer benchmark: " << gridSize << "x" << gridSize << " grid, " << frames << " frames" << std::endl;
+
+    /* Known answers: the second copy of a triangle is all hits in a 3 entry FIFO, and a degenerate
+    triangle misses once for its three indices even with a single entry. */
+    const unsigned int repeated[] = { 0, 1, 2, 0, 1, 2 };
+    const unsigned int degenerate[] = { 0, 0, 0 };
+    float repeatedACMR = ComputeACMR(repeated, 6, 3, 3);
+    float degenerateACMR = ComputeACMR(degenerate, 3, 1, 1);
+    std::cout << "ACMR check: " << repeatedACMR << " (expected 1.5), " << degenerateACMR << " (expected 1)" << std::endl;
+    ASSERT(repeatedACMR == 1.5f && degenerateACMR == 1.0f);
+
+    /* A grid with its triangles shuffled, the worst case an exporter can hand over. */
+    unsigned int side = gridSize + 1;
+    std::vector<float> vertices;
+    for (unsigned int y = 0; y < side; y++)
+    {
+        for (unsigned int x = 0; x < side; x++)
+        {
+            float u = (float)x / gridSize;
+            float v = (float)y / gridSize;
+            float position[] = { -1.5f + u * 3.0f, -1.0f + v * 2.0f, u, v };
+            vertices.insert(vertices.end(), position, position + 4);
+        }
+    }
+
+    std::vector<unsigned int> triangles;
+    for (unsigned int y = 0; y < gridSize; y++)
+    {
+        for (unsigned int x = 0; x < gridSize; x++)
+        {
+            unsigned int a = y * side + x;
+            unsigned int quad[] = { a, a + 1, a + side + 1, a + side + 1, a + side, a };
+            triangles.insert(triangles.end(), quad, quad + 6);
+        }
+    }
+    std::vector<unsigned int> order(triangles.size() / 3);
+    for (unsigned int i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+    std::vector<unsigned int> shuffled;
+    for (unsigned int t : order)
+        shuffled.insert(shuffled.end(), triangles.begin() + t * 3, triangles.begin() + t * 3 + 3);
+
+    std::vector<float> optimizedVertices = vertices;
+    std::vector<unsigned int> optimized = shuffled;
+    MeshOptimizationReport report = OptimizeMesh(optimizedVertices.data(), side * side, 4 * sizeof(float),
+        optimized.data(), optimized.size());
+    std::cout << "ACMR (16 entry FIFO): " << report.ACMRBefore << " before, " << report.ACMRAfter << " after" << std::endl;
+
+    glm::mat4 proj = glm::ortho(-2.0f, 2.0f, -1.50f, 1.50f, -0.5f, 0.5f);
+    UniformBuffer camera(sizeof(glm::mat4));
+    UniformBuffer material(sizeof(glm::vec4));
+    SetupUniformBlocks(camera, material, proj);
+    TextureCache::Handle skel = textures.Load("res/textures/skel.png");
+    Texture& texture = skel.Get();
+    Renderer renderer;
+    Shader shader("res/shaders/Basic.shader");
+    shader.Bind();
+    texture.Bind();
+    shader.SetUniform1i("u_Texture", 0);
+    shader.SetUniformMat4f("u_Model", glm::mat4(1.0f));
+
+    VertexBufferLayout layout;
+    layout.Push<float>(2);
+    layout.Push<float>(2);
+
+    const char* names[] = { "Shuffled", "Optimized" };
+    const std::vector<float>* vertexData[] = { &vertices, &optimizedVertices };
+    const std::vector<unsigned int>* indexData[] = { &shuffled, &optimized };
+    for (int i = 0; i < 2; i++)
+    {
+        VertexArray va;
+        va.Bind();
+        VertexBuffer vb(vertexData[i]->data(), (unsigned int)(vertexData[i]->size() * sizeof(float)));
+        va.AddBuffer(vb, layout);
+        IndexBuffer ib(indexData[i]->data(), (unsigned int)indexData[i]->size());
+
+        double seconds = TimeFrames(frames, [&]()
+        {
+            renderer.Clear();
+            renderer.Draw(va, ib, shader);
+        });
+        std::cout << names[i] << ": " << seconds * 1000.0 / frames << " ms/frame, "
+            << GetIndexTypeName(ib.GetType()) << " indices" << std::endl;
+    }
+
+    /* The optimized grid again as full vertices, then quantized to half their size. */
+    std::vector<MeshVertex> meshVertices(side * side);
+    for (unsigned int i = 0; i < meshVertices.size(); i++)
+    {
+        const float* vertex = &optimizedVertices[i * 4];
+        meshVertices[i] = { glm::vec3(vertex[0], vertex[1], 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec2(vertex[2], vertex[3]) };
+    }
+    QuantizedMesh quantized = QuantizeMesh(meshVertices);
+    unsigned int floatBytes = (unsigned int)(meshVertices.size() * sizeof(MeshVertex));
+    unsigned int quantizedBytes = (unsigned int)(quantized.Vertices.size() * sizeof(QuantizedVertex));
+    std::cout << "Vertex data: " << floatBytes << " bytes before, " << quantizedBytes << " bytes after quantizing, max position error "
+        << GetMaxPositionError(meshVertices.data(), meshVertices.size(), quantized) << std::endl;
+
+    Shader meshShader("res/shaders/Mesh.shader");
+    meshShader.Bind();
+    meshShader.SetUniform1i("u_Texture", 0);
+    IndexBuffer ib(optimized.data(), (unsigned int)optimized.size());
+
+    const char* meshNames[] = { "MeshVertex", "QuantizedVertex" };
+    const void* meshData[] = { meshVertices.data(), quantized.Vertices.data() };
+    unsigned int meshBytes[] = { floatBytes, quantizedBytes };
+    VertexLayoutView meshLayouts[] = { MeshVertexLayout, QuantizedVertexLayout };
+    /* Quantized positions are relative to the mesh bounds, Dequantize takes them back to the grid. */
+    glm::mat4 models[] = { glm::mat4(1.0f), quantized.Dequantize };
+    for (int i = 0; i < 2; i++)
+    {
+        VertexArray va;
+        va.Bind();
+        VertexBuffer vb(meshData[i], meshBytes[i]);
+        va.AddBuffer(vb, meshLayouts[i]);
+        meshShader.SetUniformMat4f("u_Model", models[i]);
+
+        double seconds = TimeFrames(frames, [&]()
+        {
+            renderer.Clear();
+            renderer.Draw(va, ib, meshShader);
+        });
+        std::cout << meshNames[i] << ": " << seconds * 1000.0 / frames << " ms/frame, "
+            << meshBytes[i] / meshVertices.size() << " bytes/vertex" << std::endl;
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+/* Headless benchmarks, run with --benchmark. They need a current openGL context but no visible window. */
+
+class TextureCache;
+
+/* Draws quadCount quads for the given number of frames through per-object Renderer::Draw calls with and without the
+VertexArrayCache, the BatchRenderer, and a geometry arena flushed through the render queue and through multi-draw indirect,
+and prints quads per second for each. */
+void RunQuadBenchmark(TextureCache& textures, unsigned int quadCount, unsigned int frames);
+
+/* Draws one quad instanceCount times, once as SetUniformMat4f + Draw per copy
+and once as a single DrawInstanced, and prints instances per second for both. */
+void RunInstancingBenchmark(TextureCache& textures, unsigned int instanceCount, unsigned int frames);
+
+/* Moves every updateStride-th of instanceCount instanced quads each frame and uploads the new transforms through
+SetSubData, through QueueSubData on a static buffer and through QueueSubData on a dynamic buffer, and prints the
+frame time and the number of buffer uploads per frame for each. */
+void RunBufferUpdateBenchmark(TextureCache& textures, unsigned int instanceCount, unsigned int updateStride, unsigned int frames);
+
+/* Sets a mat4 uniform callCount times through the old string keyed location cache,
+through a UniformName and through a precomputed handle, and prints calls per second for each. */
+void RunUniformBenchmark(unsigned int callCount);
+
+/* Runs OptimizeMesh on a gridSize x gridSize grid with shuffled triangles, prints the ACMR before and after
+and the draw time of both versions. Then quantizes the optimized grid and prints the vertex bytes before and after,
+the largest position error and the draw time through MeshVertexLayout and QuantizedVertexLayout. */
+void RunMeshOptimizerBenchmark(TextureCache& textures, unsigned int gridSize, unsigned int frames);
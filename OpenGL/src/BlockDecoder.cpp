@@ -0,0 +1,366 @@
+#include "BlockDecoder.h"
+
+#include <cstring>
+
+namespace {
+
+	/* Pixels of one block, row by row, 4 bytes each. */
+	typedef unsigned char BlockPixels[16][4];
+
+	void Expand565(unsigned int color, unsigned char* rgb)
+	{
+		unsigned int r = (color >> 11) & 31;
+		unsigned int g = (color >> 5) & 63;
+		unsigned int b = color & 31;
+		rgb[0] = (unsigned char)((r << 3) | (r >> 2));
+		rgb[1] = (unsigned char)((g << 2) | (g >> 4));
+		rgb[2] = (unsigned char)((b << 3) | (b >> 2));
+	}
+
+	/* BC2 and BC3 always use four colors, only BC1 has the three color mode with transparent black. */
+	void DecodeColorBlock(const unsigned char* block, BlockPixels& pixels, bool allowPunchThrough)
+	{
+		unsigned int color0 = block[0] | (block[1] << 8);
+		unsigned int color1 = block[2] | (block[3] << 8);
+
+		unsigned char palette[4][4];
+		Expand565(color0, palette[0]);
+		Expand565(color1, palette[1]);
+		palette[0][3] = palette[1][3] = 255;
+
+		for (int c = 0; c < 3; c++)
+		{
+			if (color0 > color1 || !allowPunchThrough)
+			{
+				palette[2][c] = (unsigned char)((2 * palette[0][c] + palette[1][c]) / 3);
+				palette[3][c] = (unsigned char)((palette[0][c] + 2 * palette[1][c]) / 3);
+			}
+			else
+			{
+				palette[2][c] = (unsigned char)((palette[0][c] + palette[1][c]) / 2);
+				palette[3][c] = 0;
+			}
+		}
+		palette[2][3] = 255;
+		palette[3][3] = color0 > color1 || !allowPunchThrough ? 255 : 0;
+
+		unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+		for (int i = 0; i < 16; i++)
+			memcpy(pixels[i], palette[(indices >> (2 * i)) & 3], 4);
+	}
+
+	/* BC4 block, also the alpha of BC3 and each channel of BC5. Writes channel of every pixel. */
+	void DecodeChannelBlock(const unsigned char* block, BlockPixels& pixels, int channel)
+	{
+		unsigned int value0 = block[0];
+		unsigned int value1 = block[1];
+
+		unsigned char palette[8];
+		palette[0] = (unsigned char)value0;
+		palette[1] = (unsigned char)value1;
+		if (value0 > value1)
+		{
+			for (unsigned int i = 1; i < 7; i++)
+				palette[i + 1] = (unsigned char)(((7 - i) * value0 + i * value1) / 7);
+		}
+		else
+		{
+			for (unsigned int i = 1; i < 5; i++)
+				palette[i + 1] = (unsigned char)(((5 - i) * value0 + i * value1) / 5);
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		unsigned long long indices = 0;
+		for (int i = 0; i < 6; i++)
+			indices |= (unsigned long long)block[2 + i] << (8 * i);
+
+		for (int i = 0; i < 16; i++)
+			pixels[i][channel] = palette[(indices >> (3 * i)) & 7];
+	}
+
+	/* BC7 tables, from the BPTC specification. */
+	const unsigned char Partitions2[64][16] = {
+		{ 0,0,1,1,0,0,1,1,0,0,1,1,0,0,1,1 }, { 0,0,0,1,0,0,0,1,0,0,0,1,0,0,0,1 }, { 0,1,1,1,0,1,1,1,0,1,1,1,0,1,1,1 }, { 0,0,0,1,0,0,1,1,0,0,1,1,0,1,1,1 },
+		{ 0,0,0,0,0,0,0,1,0,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,1,0,1,1,1,1,1,1,1 }, { 0,0,0,1,0,0,1,1,0,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,1,0,0,1,1,0,1,1,1 },
+		{ 0,0,0,0,0,0,0,0,0,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,1,0,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,0,0,0,1,0,1,1,1 },
+		{ 0,0,0,1,0,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,1,1,1,1,1,1,1,1 }, { 0,0,0,0,1,1,1,1,1,1,1,1,1,1,1,1 }, { 0,0,0,0,0,0,0,0,0,0,0,0,1,1,1,1 },
+		{ 0,0,0,0,1,0,0,0,1,1,1,0,1,1,1,1 }, { 0,1,1,1,0,0,0,1,0,0,0,0,0,0,0,0 }, { 0,0,0,0,0,0,0,0,1,0,0,0,1,1,1,0 }, { 0,1,1,1,0,0,1,1,0,0,0,1,0,0,0,0 },
+		{ 0,0,1,1,0,0,0,1,0,0,0,0,0,0,0,0 }, { 0,0,0,0,1,0,0,0,1,1,0,0,1,1,1,0 }, { 0,0,0,0,0,0,0,0,1,0,0,0,1,1,0,0 }, { 0,1,1,1,0,0,1,1,0,0,1,1,0,0,0,1 },
+		{ 0,0,1,1,0,0,0,1,0,0,0,1,0,0,0,0 }, { 0,0,0,0,1,0,0,0,1,0,0,0,1,1,0,0 }, { 0,1,1,0,0,1,1,0,0,1,1,0,0,1,1,0 }, { 0,0,1,1,0,1,1,0,0,1,1,0,1,1,0,0 },
+		{ 0,0,0,1,0,1,1,1,1,1,1,0,1,0,0,0 }, { 0,0,0,0,1,1,1,1,1,1,1,1,0,0,0,0 }, { 0,1,1,1,0,0,0,1,1,0,0,0,1,1,1,0 }, { 0,0,1,1,1,0,0,1,1,0,0,1,1,1,0,0 },
+		{ 0,1,0,1,0,1,0,1,0,1,0,1,0,1,0,1 }, { 0,0,0,0,1,1,1,1,0,0,0,0,1,1,1,1 }, { 0,1,0,1,1,0,1,0,0,1,0,1,1,0,1,0 }, { 0,0,1,1,0,0,1,1,1,1,0,0,1,1,0,0 },
+		{ 0,0,1,1,1,1,0,0,0,0,1,1,1,1,0,0 }, { 0,1,0,1,0,1,0,1,1,0,1,0,1,0,1,0 }, { 0,1,1,0,1,0,0,1,0,1,1,0,1,0,0,1 }, { 0,1,0,1,1,0,1,0,1,0,1,0,0,1,0,1 },
+		{ 0,1,1,1,0,0,1,1,1,1,0,0,1,1,1,0 }, { 0,0,0,1,0,0,1,1,1,1,0,0,1,0,0,0 }, { 0,0,1,1,0,0,1,0,0,1,0,0,1,1,0,0 }, { 0,0,1,1,1,0,1,1,1,1,0,1,1,1,0,0 },
+		{ 0,1,1,0,1,0,0,1,1,0,0,1,0,1,1,0 }, { 0,0,1,1,1,1,0,0,1,1,0,0,0,0,1,1 }, { 0,1,1,0,0,1,1,0,1,0,0,1,1,0,0,1 }, { 0,0,0,0,0,1,1,0,0,1,1,0,0,0,0,0 },
+		{ 0,1,0,0,1,1,1,0,0,1,0,0,0,0,0,0 }, { 0,0,1,0,0,1,1,1,0,0,1,0,0,0,0,0 }, { 0,0,0,0,0,0,1,0,0,1,1,1,0,0,1,0 }, { 0,0,0,0,0,1,0,0,1,1,1,0,0,1,0,0 },
+		{ 0,1,1,0,1,1,0,0,1,0,0,1,0,0,1,1 }, { 0,0,1,1,0,1,1,0,1,1,0,0,1,0,0,1 }, { 0,1,1,0,0,0,1,1,1,0,0,1,1,1,0,0 }, { 0,0,1,1,1,0,0,1,1,1,0,0,0,1,1,0 },
+		{ 0,1,1,0,1,1,0,0,1,1,0,0,1,0,0,1 }, { 0,1,1,0,0,0,1,1,0,0,1,1,1,0,0,1 }, { 0,1,1,1,1,1,1,0,1,0,0,0,0,0,0,1 }, { 0,0,0,1,1,0,0,0,1,1,1,0,0,1,1,1 },
+		{ 0,0,0,0,1,1,1,1,0,0,1,1,0,0,1,1 }, { 0,0,1,1,0,0,1,1,1,1,1,1,0,0,0,0 }, { 0,0,1,0,0,0,1,0,1,1,1,0,1,1,1,0 }, { 0,1,0,0,0,1,0,0,0,1,1,1,0,1,1,1 }
+	};
+
+	const unsigned char Partitions3[64][16] = {
+		{ 0,0,1,1,0,0,1,1,0,2,2,1,2,2,2,2 }, { 0,0,0,1,0,0,1,1,2,2,1,1,2,2,2,1 }, { 0,0,0,0,2,0,0,1,2,2,1,1,2,2,1,1 }, { 0,2,2,2,0,0,2,2,0,0,1,1,0,1,1,1 },
+		{ 0,0,0,0,0,0,0,0,1,1,2,2,1,1,2,2 }, { 0,0,1,1,0,0,1,1,0,0,2,2,0,0,2,2 }, { 0,0,2,2,0,0,2,2,1,1,1,1,1,1,1,1 }, { 0,0,1,1,0,0,1,1,2,2,1,1,2,2,1,1 },
+		{ 0,0,0,0,0,0,0,0,1,1,1,1,2,2,2,2 }, { 0,0,0,0,1,1,1,1,1,1,1,1,2,2,2,2 }, { 0,0,0,0,1,1,1,1,2,2,2,2,2,2,2,2 }, { 0,0,1,2,0,0,1,2,0,0,1,2,0,0,1,2 },
+		{ 0,1,1,2,0,1,1,2,0,1,1,2,0,1,1,2 }, { 0,1,2,2,0,1,2,2,0,1,2,2,0,1,2,2 }, { 0,0,1,1,0,1,1,2,1,1,2,2,1,2,2,2 }, { 0,0,1,1,2,0,0,1,2,2,0,0,2,2,2,0 },
+		{ 0,0,0,1,0,0,1,1,0,1,1,2,1,1,2,2 }, { 0,1,1,1,0,0,1,1,2,0,0,1,2,2,0,0 }, { 0,0,0,0,1,1,2,2,1,1,2,2,1,1,2,2 }, { 0,0,2,2,0,0,2,2,0,0,2,2,1,1,1,1 },
+		{ 0,1,1,1,0,1,1,1,0,2,2,2,0,2,2,2 }, { 0,0,0,1,0,0,0,1,2,2,2,1,2,2,2,1 }, { 0,0,0,0,0,0,1,1,0,1,2,2,0,1,2,2 }, { 0,0,0,0,1,1,0,0,2,2,1,0,2,2,1,0 },
+		{ 0,1,2,2,0,1,2,2,0,0,1,1,0,0,0,0 }, { 0,0,1,2,0,0,1,2,1,1,2,2,2,2,2,2 }, { 0,1,1,0,1,2,2,1,1,2,2,1,0,1,1,0 }, { 0,0,0,0,0,1,1,0,1,2,2,1,1,2,2,1 },
+		{ 0,0,2,2,1,1,0,2,1,1,0,2,0,0,2,2 }, { 0,1,1,0,0,1,1,0,2,0,0,2,2,2,2,2 }, { 0,0,1,1,0,1,2,2,0,1,2,2,0,0,1,1 }, { 0,0,0,0,2,0,0,0,2,2,1,1,2,2,2,1 },
+		{ 0,0,0,0,0,0,0,2,1,1,2,2,1,2,2,2 }, { 0,2,2,2,0,0,2,2,0,0,1,2,0,0,1,1 }, { 0,0,1,1,0,0,1,2,0,0,2,2,0,2,2,2 }, { 0,1,2,0,0,1,2,0,0,1,2,0,0,1,2,0 },
+		{ 0,0,0,0,1,1,1,1,2,2,2,2,0,0,0,0 }, { 0,1,2,0,1,2,0,1,2,0,1,2,0,1,2,0 }, { 0,1,2,0,2,0,1,2,1,2,0,1,0,1,2,0 }, { 0,0,1,1,2,2,0,0,1,1,2,2,0,0,1,1 },
+		{ 0,0,1,1,1,1,2,2,2,2,0,0,0,0,1,1 }, { 0,1,0,1,0,1,0,1,2,2,2,2,2,2,2,2 }, { 0,0,0,0,0,0,0,0,2,1,2,1,2,1,2,1 }, { 0,0,2,2,1,1,2,2,0,0,2,2,1,1,2,2 },
+		{ 0,0,2,2,0,0,1,1,0,0,2,2,0,0,1,1 }, { 0,2,2,0,1,2,2,1,0,2,2,0,1,2,2,1 }, { 0,1,0,1,2,2,2,2,2,2,2,2,0,1,0,1 }, { 0,0,0,0,2,1,2,1,2,1,2,1,2,1,2,1 },
+		{ 0,1,0,1,0,1,0,1,0,1,0,1,2,2,2,2 }, { 0,2,2,2,0,1,1,1,0,2,2,2,0,1,1,1 }, { 0,0,0,2,1,1,1,2,0,0,0,2,1,1,1,2 }, { 0,0,0,0,2,1,1,2,2,1,1,2,2,1,1,2 },
+		{ 0,2,2,2,0,1,1,1,0,1,1,1,0,2,2,2 }, { 0,0,0,2,1,1,1,2,1,1,1,2,0,0,0,2 }, { 0,1,1,0,0,1,1,0,0,1,1,0,2,2,2,2 }, { 0,0,0,0,0,0,0,0,2,1,1,2,2,1,1,2 },
+		{ 0,1,1,0,0,1,1,0,2,2,2,2,2,2,2,2 }, { 0,0,2,2,0,0,1,1,0,0,1,1,0,0,2,2 }, { 0,0,2,2,1,1,2,2,1,1,2,2,0,0,2,2 }, { 0,0,0,0,0,0,0,0,0,0,0,0,2,1,1,2 },
+		{ 0,0,0,2,0,0,0,1,0,0,0,2,0,0,0,1 }, { 0,2,2,2,1,2,2,2,0,2,2,2,1,2,2,2 }, { 0,1,0,1,2,2,2,2,2,2,2,2,2,2,2,2 }, { 0,1,1,1,2,0,1,1,2,2,0,1,2,2,2,0 }
+	};
+
+	/* Pixel whose index drops its top bit, for the second subset of two and the second and third of three. */
+	const unsigned char Anchors2[64] = {
+		15,15,15,15,15,15,15,15, 15,15,15,15,15,15,15,15, 15, 2, 8, 2, 2, 8, 8,15,  2, 8, 2, 2, 8, 8, 2, 2,
+		15,15, 6, 8, 2, 8,15,15,  2, 8, 2, 2, 2,15,15, 6,  6, 2, 6, 8,15,15, 2, 2, 15,15,15,15,15, 2, 2,15
+	};
+	const unsigned char Anchors3Second[64] = {
+		 3, 3,15,15, 8, 3,15,15,  8, 8, 6, 6, 6, 5, 3, 3,  3, 3, 8,15, 3, 3, 6,10,  5, 8, 8, 6, 8, 5,15,15,
+		 8,15, 3, 5, 6,10, 8,15, 15, 3,15, 5,15,15,15,15,  3,15, 5, 5, 5, 8, 5,10,  5,10, 8,13,15,12, 3, 3
+	};
+	const unsigned char Anchors3Third[64] = {
+		15, 8, 8, 3,15,15, 3, 8, 15,15,15,15,15,15,15, 8, 15, 8,15, 3,15, 8,15, 8,  3,15, 6,10,15,15,10, 8,
+		15, 3,15,10,10, 8, 9,10,  6,15, 8,15, 3, 6, 6, 8, 15, 3,15,15,15,15,15,15, 15,15,15,15, 3,15,15, 8
+	};
+
+	const unsigned char Weights2[4] = { 0, 21, 43, 64 };
+	const unsigned char Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	const unsigned char Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	struct BC7Mode
+	{
+		unsigned int Subsets, PartitionBits, RotationBits, IndexSelectionBits;
+		unsigned int ColorBits, AlphaBits, EndpointPBits, SharedPBits;
+		unsigned int IndexBits, SecondaryIndexBits;
+	};
+
+	const BC7Mode BC7Modes[8] = {
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+	};
+
+	/* Reads the 128 bit block from the least significant bit of the first byte on. */
+	struct BitReader
+	{
+		const unsigned char* Data;
+		unsigned int Position;
+
+		unsigned int Read(unsigned int count)
+		{
+			unsigned int value = 0;
+			for (unsigned int i = 0; i < count; i++, Position++)
+				value |= ((Data[Position >> 3] >> (Position & 7)) & 1u) << i;
+			return value;
+		}
+	};
+
+	unsigned char Interpolate(unsigned int e0, unsigned int e1, unsigned int indexBits, unsigned int index)
+	{
+		const unsigned char* weights = indexBits == 2 ? Weights2 : indexBits == 3 ? Weights3 : Weights4;
+		unsigned int w = weights[index];
+		return (unsigned char)(((64 - w) * e0 + w * e1 + 32) >> 6);
+	}
+
+	void DecodeBC7Block(const unsigned char* block, BlockPixels& pixels)
+	{
+		BitReader bits = { block, 0 };
+
+		unsigned int mode = 0;
+		while (mode < 8 && bits.Read(1) == 0)
+			mode++;
+
+		/* Reserved mode, decodes to transparent black. */
+		if (mode == 8)
+		{
+			memset(pixels, 0, sizeof(BlockPixels));
+			return;
+		}
+
+		const BC7Mode& info = BC7Modes[mode];
+		unsigned int partition = bits.Read(info.PartitionBits);
+		unsigned int rotation = bits.Read(info.RotationBits);
+		unsigned int indexSelection = bits.Read(info.IndexSelectionBits);
+
+		/* Two endpoints per subset, RGBA. */
+		unsigned int endpoints[6][4];
+		unsigned int endpointCount = info.Subsets * 2;
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			for (unsigned int e = 0; e < endpointCount; e++)
+				endpoints[e][c] = bits.Read(info.ColorBits);
+		}
+		for (unsigned int e = 0; e < endpointCount; e++)
+			endpoints[e][3] = info.AlphaBits ? bits.Read(info.AlphaBits) : 255;
+
+		/* Append the p-bits and scale every endpoint up to 8 bits. */
+		unsigned int pBits[6] = { 0 };
+		unsigned int hasPBit = info.EndpointPBits || info.SharedPBits;
+		if (info.EndpointPBits)
+		{
+			for (unsigned int e = 0; e < endpointCount; e++)
+				pBits[e] = bits.Read(1);
+		}
+		else if (info.SharedPBits)
+		{
+			for (unsigned int s = 0; s < info.Subsets; s++)
+				pBits[s * 2] = pBits[s * 2 + 1] = bits.Read(1);
+		}
+
+		for (unsigned int e = 0; e < endpointCount; e++)
+		{
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				unsigned int precision = c < 3 ? info.ColorBits : info.AlphaBits;
+				if (precision == 0)
+					continue;
+
+				unsigned int value = endpoints[e][c];
+				if (hasPBit)
+				{
+					value = (value << 1) | pBits[e];
+					precision++;
+				}
+				value <<= 8 - precision;
+				endpoints[e][c] = value | (value >> precision);
+			}
+		}
+
+		unsigned int subsetOf[16] = { 0 };
+		unsigned int anchor1 = 0, anchor2 = 0;
+		if (info.Subsets == 2)
+		{
+			for (int i = 0; i < 16; i++)
+				subsetOf[i] = Partitions2[partition][i];
+			anchor1 = Anchors2[partition];
+		}
+		else if (info.Subsets == 3)
+		{
+			for (int i = 0; i < 16; i++)
+				subsetOf[i] = Partitions3[partition][i];
+			anchor1 = Anchors3Second[partition];
+			anchor2 = Anchors3Third[partition];
+		}
+
+		unsigned int indices[16];
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			bool anchor = i == 0 || (info.Subsets > 1 && i == anchor1) || (info.Subsets > 2 && i == anchor2);
+			indices[i] = bits.Read(anchor ? info.IndexBits - 1 : info.IndexBits);
+		}
+
+		unsigned int secondaryIndices[16] = { 0 };
+		if (info.SecondaryIndexBits)
+		{
+			for (unsigned int i = 0; i < 16; i++)
+				secondaryIndices[i] = bits.Read(i == 0 ? info.SecondaryIndexBits - 1 : info.SecondaryIndexBits);
+		}
+
+		for (unsigned int i = 0; i < 16; i++)
+		{
+			const unsigned int* e0 = endpoints[subsetOf[i] * 2];
+			const unsigned int* e1 = endpoints[subsetOf[i] * 2 + 1];
+
+			unsigned int colorBits = info.IndexBits, colorIndex = indices[i];
+			unsigned int alphaBits = info.IndexBits, alphaIndex = indices[i];
+			if (info.SecondaryIndexBits)
+			{
+				/* Modes 4 and 5 index color and alpha separately, the selection bit swaps the two sets. */
+				alphaBits = info.SecondaryIndexBits;
+				alphaIndex = secondaryIndices[i];
+				if (indexSelection)
+				{
+					unsigned int bitsSwap = colorBits, indexSwap = colorIndex;
+					colorBits = alphaBits;
+					colorIndex = alphaIndex;
+					alphaBits = bitsSwap;
+					alphaIndex = indexSwap;
+				}
+			}
+
+			for (unsigned int c = 0; c < 3; c++)
+				pixels[i][c] = Interpolate(e0[c], e1[c], colorBits, colorIndex);
+			pixels[i][3] = Interpolate(e0[3], e1[3], alphaBits, alphaIndex);
+
+			/* Rotation stores one color channel in the alpha slot, swap it back. */
+			if (rotation)
+			{
+				unsigned char swap = pixels[i][3];
+				pixels[i][3] = pixels[i][rotation - 1];
+				pixels[i][rotation - 1] = swap;
+			}
+		}
+	}
+
+	void DecodeBlock(BlockFormat format, const unsigned char* block, BlockPixels& pixels)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1:
+			DecodeColorBlock(block, pixels, true);
+			break;
+		case BlockFormat::BC3:
+			DecodeColorBlock(block + 8, pixels, false);
+			DecodeChannelBlock(block, pixels, 3);
+			break;
+		case BlockFormat::BC4:
+			for (int i = 0; i < 16; i++)
+			{
+				pixels[i][1] = pixels[i][2] = 0;
+				pixels[i][3] = 255;
+			}
+			DecodeChannelBlock(block, pixels, 0);
+			break;
+		case BlockFormat::BC5:
+			for (int i = 0; i < 16; i++)
+			{
+				pixels[i][2] = 0;
+				pixels[i][3] = 255;
+			}
+			DecodeChannelBlock(block, pixels, 0);
+			DecodeChannelBlock(block + 8, pixels, 1);
+			break;
+		case BlockFormat::BC7:
+			DecodeBC7Block(block, pixels);
+			break;
+		}
+	}
+}
+
+void DecodeBlockImage(BlockFormat format, const unsigned char* data, int width, int height, unsigned char* rgba)
+{
+	unsigned int blockBytes = GetBlockBytes(format);
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+
+	BlockPixels pixels;
+	for (int by = 0; by < blocksY; by++)
+	{
+		for (int bx = 0; bx < blocksX; bx++)
+		{
+			DecodeBlock(format, data, pixels);
+			data += blockBytes;
+
+			/* Blocks on the right and bottom edge may hang over the image. */
+			for (int y = 0; y < 4 && by * 4 + y < height; y++)
+			{
+				int columns = width - bx * 4 < 4 ? width - bx * 4 : 4;
+				memcpy(rgba + ((size_t)(by * 4 + y) * width + bx * 4) * 4, pixels[y * 4], columns * 4);
+			}
+		}
+	}
+}
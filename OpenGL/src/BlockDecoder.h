@@ -0,0 +1,8 @@
+#pragma once
+
+#include "CompressedImage.h"
+
+/* CPU fallback for contexts that can't sample a block format, e.g. software GL without S3TC.
+Decodes width * height pixels of format into tightly packed RGBA8. Single channel formats
+give (r, 0, 0, 255) and two channel formats (r, g, 0, 255), matching how GL samples them. */
+void DecodeBlockImage(BlockFormat format, const unsigned char* data, int width, int height, unsigned char* rgba);
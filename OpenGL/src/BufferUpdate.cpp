@@ -0,0 +1,152 @@
+#include "BufferUpdate.h"
+#include "Renderer.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <cstring>
+
+unsigned int GetGLBufferUsage(BufferUsage usage)
+{
+	switch (usage)
+	{
+		case BufferUsage::Static:	return GL_STATIC_DRAW;
+		case BufferUsage::Dynamic:	return GL_DYNAMIC_DRAW;
+		case BufferUsage::Stream:	return GL_STREAM_DRAW;
+	}
+
+	ASSERT(false);
+	return GL_STATIC_DRAW;
+}
+
+unsigned int CreateBuffer(unsigned int target)
+{
+	unsigned int buffer = 0;
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glCreateBuffers(1, &buffer));
+	}
+	else
+	{
+		/* A generated name only becomes a buffer object once it is bound. */
+		GLCall(glGenBuffers(1, &buffer));
+		GLState::BindBuffer(target, buffer);
+	}
+	return buffer;
+}
+
+void SetBufferData(unsigned int buffer, unsigned int target, unsigned int size, const void* data, unsigned int usage)
+{
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glNamedBufferData(buffer, size, data, usage));
+	}
+	else
+	{
+		GLState::BindBuffer(target, buffer);
+		GLCall(glBufferData(target, size, data, usage));
+	}
+}
+
+void SetBufferSubData(unsigned int buffer, unsigned int target, unsigned int offset, unsigned int size, const void* data)
+{
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glNamedBufferSubData(buffer, offset, size, data));
+	}
+	else
+	{
+		GLState::BindBuffer(target, buffer);
+		GLCall(glBufferSubData(target, offset, size, data));
+	}
+}
+
+void CopyBufferRange(unsigned int source, unsigned int destination, unsigned int sourceOffset, unsigned int destinationOffset, unsigned int size)
+{
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glCopyNamedBufferSubData(source, destination, sourceOffset, destinationOffset, size));
+	}
+	else
+	{
+		GLState::BindBuffer(GL_COPY_READ_BUFFER, source);
+		GLState::BindBuffer(GL_COPY_WRITE_BUFFER, destination);
+		GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, sourceOffset, destinationOffset, size));
+	}
+}
+
+PendingBufferUpdates::PendingBufferUpdates(bool mirror)
+	:m_Mirror(mirror)
+{
+}
+
+void PendingBufferUpdates::Seed(const void* data, unsigned int size, unsigned int bufferSize)
+{
+	if (!m_Mirror)
+		return;
+
+	/* Bytes past size are undefined in the buffer, whatever the copy holds there is as good. */
+	m_Data.resize(bufferSize);
+	if (data && size > 0)
+		memcpy(m_Data.data(), data, size);
+}
+
+void PendingBufferUpdates::Mirror(const void* data, unsigned int size, unsigned int offset)
+{
+	if (!m_Mirror || size == 0)
+		return;
+
+	if (m_Data.size() < offset + size)
+		m_Data.resize(offset + size);
+	memcpy(m_Data.data() + offset, data, size);
+}
+
+void PendingBufferUpdates::Write(const void* data, unsigned int size, unsigned int offset)
+{
+	if (size == 0)
+		return;
+
+	if (m_Data.size() < offset + size)
+		m_Data.resize(offset + size);
+	memcpy(m_Data.data() + offset, data, size);
+	m_Ranges.push_back({ offset, offset + size });
+}
+
+unsigned int PendingBufferUpdates::Upload(unsigned int buffer, unsigned int bufferSize, unsigned int usage)
+{
+	if (m_Ranges.empty())
+		return 0;
+
+	std::sort(m_Ranges.begin(), m_Ranges.end());
+	/* The copy only knows the bytes between ranges when it mirrors the buffer. */
+	unsigned int maxGap = m_Mirror ? MaxMergedGap : 0;
+	unsigned int merged = 0;
+	for (unsigned int i = 1; i < m_Ranges.size(); i++)
+	{
+		auto& last = m_Ranges[merged];
+		if (m_Ranges[i].first <= last.second + maxGap)
+			last.second = std::max(last.second, m_Ranges[i].second);
+		else
+			m_Ranges[++merged] = m_Ranges[i];
+	}
+	m_Ranges.resize(merged + 1);
+
+	/* The copy target leaves vertex array state alone, index buffers are updated through it as well. */
+	if (m_Ranges.size() == 1 && m_Ranges[0].first == 0 && m_Ranges[0].second >= bufferSize)
+	{
+		SetBufferData(buffer, GL_COPY_WRITE_BUFFER, bufferSize, m_Data.data(), usage);
+	}
+	else
+	{
+		for (const auto& range : m_Ranges)
+			SetBufferSubData(buffer, GL_COPY_WRITE_BUFFER, range.first, range.second - range.first, m_Data.data() + range.first);
+	}
+
+	unsigned int uploads = (unsigned int)m_Ranges.size();
+	m_Ranges.clear();
+	return uploads;
+}
+
+void PendingBufferUpdates::Clear()
+{
+	m_Ranges.clear();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+/* How often a buffer's contents change, picks the GL usage hint. */
+enum class BufferUsage
+{
+	/* Written once, drawn many times. */
+	Static,
+	/* Rewritten now and then, drawn many times in between. */
+	Dynamic,
+	/* Rewritten about as often as it is drawn. */
+	Stream
+};
+
+unsigned int GetGLBufferUsage(BufferUsage usage);
+
+/* Buffer object helpers that work by name through direct state access when the context has it, and bind buffer
+to target first otherwise. Target only matters for the fallback, GL_COPY_WRITE_BUFFER leaves vertex arrays alone. */
+unsigned int CreateBuffer(unsigned int target);
+void SetBufferData(unsigned int buffer, unsigned int target, unsigned int size, const void* data, unsigned int usage);
+void SetBufferSubData(unsigned int buffer, unsigned int target, unsigned int offset, unsigned int size, const void* data);
+/* glCopyBufferSubData between two buffers, through the copy targets without direct state access. */
+void CopyBufferRange(unsigned int source, unsigned int destination, unsigned int sourceOffset, unsigned int destinationOffset, unsigned int size);
+
+/* Staging for QueueSubData. Writes land in a CPU copy and their byte ranges are remembered, Upload then merges
+them and sends each merged range once, later writes winning. When the copy mirrors the whole buffer the bytes
+between two ranges are known, so ranges up to MaxMergedGap apart are merged too and scattered small writes become
+one upload. Without a mirror only overlapping and touching ranges are merged. */
+class PendingBufferUpdates
+{
+public:
+	/* Resending this many unchanged bytes costs less than another upload call. */
+	static const unsigned int MaxMergedGap = 4096;
+
+private:
+	/* All of the buffer when mirroring, otherwise only up to the highest queued byte. */
+	std::vector<unsigned char> m_Data;
+	/* [begin, end) byte ranges in write order. */
+	std::vector<std::pair<unsigned int, unsigned int>> m_Ranges;
+	bool m_Mirror;
+
+public:
+	/* mirror keeps a CPU copy of the whole buffer, worth it for buffers that are rewritten often. The owner
+	then reports every write that bypasses the queue through Seed and Mirror. */
+	explicit PendingBufferUpdates(bool mirror = false);
+
+	/* The buffer was respecified with bufferSize bytes, the first size of them from data. */
+	void Seed(const void* data, unsigned int size, unsigned int bufferSize);
+	/* size bytes of data were written at offset without going through the queue. */
+	void Mirror(const void* data, unsigned int size, unsigned int offset);
+
+	void Write(const void* data, unsigned int size, unsigned int offset);
+	/* Uploads the merged ranges to buffer and forgets them. A range covering all of bufferSize is uploaded
+	with glBufferData so the driver can orphan the old storage, smaller ones go through glBufferSubData.
+	Returns the number of uploads made. */
+	unsigned int Upload(unsigned int buffer, unsigned int bufferSize, unsigned int usage);
+	void Clear();
+
+	inline bool IsEmpty() const { return m_Ranges.empty(); }
+	inline bool IsMirrored() const { return m_Mirror; }
+};
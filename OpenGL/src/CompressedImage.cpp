@@ -0,0 +1,333 @@
+#include "CompressedImage.h"
+
+#include <GL/glew.h>
+#include <cstring>
+#include <cctype>
+#include <cstdint>
+
+namespace {
+
+	const unsigned char KTX2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+	/* Vulkan format numbers used by KTX2. */
+	enum VkFormat : uint32_t
+	{
+		VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131, VK_FORMAT_BC1_RGB_SRGB_BLOCK = 132,
+		VK_FORMAT_BC1_RGBA_UNORM_BLOCK = 133, VK_FORMAT_BC1_RGBA_SRGB_BLOCK = 134,
+		VK_FORMAT_BC3_UNORM_BLOCK = 137, VK_FORMAT_BC3_SRGB_BLOCK = 138,
+		VK_FORMAT_BC4_UNORM_BLOCK = 139, VK_FORMAT_BC5_UNORM_BLOCK = 141,
+		VK_FORMAT_BC7_UNORM_BLOCK = 145, VK_FORMAT_BC7_SRGB_BLOCK = 146
+	};
+
+	/* DXGI format numbers used by the DX10 extension of DDS. */
+	enum DxgiFormat : uint32_t
+	{
+		DXGI_FORMAT_BC1_UNORM = 71, DXGI_FORMAT_BC1_UNORM_SRGB = 72,
+		DXGI_FORMAT_BC3_UNORM = 77, DXGI_FORMAT_BC3_UNORM_SRGB = 78,
+		DXGI_FORMAT_BC4_UNORM = 80, DXGI_FORMAT_BC5_UNORM = 83,
+		DXGI_FORMAT_BC7_UNORM = 98, DXGI_FORMAT_BC7_UNORM_SRGB = 99
+	};
+
+	const uint32_t DDSMagic = 0x20534444; // "DDS "
+	const uint32_t DDSHeaderSize = 124;
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDSCAPS2_CUBEMAP = 0x200;
+	const uint32_t DDSCAPS2_VOLUME = 0x200000;
+	const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+	const uint32_t DDS_MISC_TEXTURECUBE = 0x4;
+
+	constexpr uint32_t FourCC(char a, char b, char c, char d)
+	{
+		return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+	}
+
+	/* Containers are little endian and not necessarily aligned. */
+	template<typename T>
+	T ReadValue(const unsigned char* data, size_t offset)
+	{
+		T value;
+		memcpy(&value, data + offset, sizeof(T));
+		return value;
+	}
+
+	int MaxLevelCount(int width, int height)
+	{
+		int levels = 1;
+		int size = width > height ? width : height;
+		while (size > 1)
+		{
+			size >>= 1;
+			levels++;
+		}
+		return levels;
+	}
+
+	/* Fills in level sizes and pointers for levels stored back to back, as DDS does. */
+	bool LayoutLevels(const unsigned char* data, size_t size, size_t offset, int levelCount, CompressedImage& image, std::string& error)
+	{
+		int width = image.Width;
+		int height = image.Height;
+		for (int i = 0; i < levelCount; i++)
+		{
+			size_t levelSize = GetLevelSize(image.Format, width, height);
+			if (offset > size || size - offset < levelSize)
+			{
+				error = "file is truncated";
+				return false;
+			}
+
+			/* Fits, the dimensions were capped at MaxCompressedImageSize. */
+			image.Levels.push_back({ data + offset, (unsigned int)levelSize, width, height });
+			offset += levelSize;
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+		return true;
+	}
+
+	bool ParseDDS(const unsigned char* data, size_t size, CompressedImage& image, std::string& error)
+	{
+		if (size < 4 + DDSHeaderSize || ReadValue<uint32_t>(data, 4) != DDSHeaderSize)
+		{
+			error = "invalid DDS header";
+			return false;
+		}
+
+		uint32_t flags = ReadValue<uint32_t>(data, 8);
+		image.Height = (int)ReadValue<uint32_t>(data, 12);
+		image.Width = (int)ReadValue<uint32_t>(data, 16);
+		uint32_t mipCount = ReadValue<uint32_t>(data, 28);
+		uint32_t pixelFlags = ReadValue<uint32_t>(data, 80);
+		uint32_t fourCC = ReadValue<uint32_t>(data, 84);
+		uint32_t caps2 = ReadValue<uint32_t>(data, 112);
+
+		if (!(pixelFlags & DDPF_FOURCC))
+		{
+			error = "DDS is not block compressed";
+			return false;
+		}
+		if (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME))
+		{
+			error = "only 2D DDS textures are supported";
+			return false;
+		}
+
+		size_t offset = 4 + DDSHeaderSize;
+		image.SRGB = false;
+
+		switch (fourCC)
+		{
+		case FourCC('D', 'X', 'T', '1'): image.Format = BlockFormat::BC1; break;
+		case FourCC('D', 'X', 'T', '5'): image.Format = BlockFormat::BC3; break;
+		case FourCC('A', 'T', 'I', '1'):
+		case FourCC('B', 'C', '4', 'U'): image.Format = BlockFormat::BC4; break;
+		case FourCC('A', 'T', 'I', '2'):
+		case FourCC('B', 'C', '5', 'U'): image.Format = BlockFormat::BC5; break;
+		case FourCC('D', 'X', '1', '0'):
+		{
+			if (size < offset + 20)
+			{
+				error = "file is truncated";
+				return false;
+			}
+
+			uint32_t dxgiFormat = ReadValue<uint32_t>(data, offset);
+			uint32_t dimension = ReadValue<uint32_t>(data, offset + 4);
+			uint32_t miscFlags = ReadValue<uint32_t>(data, offset + 8);
+			uint32_t arraySize = ReadValue<uint32_t>(data, offset + 12);
+			offset += 20;
+
+			if (dimension != DDS_DIMENSION_TEXTURE2D || (miscFlags & DDS_MISC_TEXTURECUBE) || arraySize > 1)
+			{
+				error = "only 2D DDS textures are supported";
+				return false;
+			}
+
+			switch (dxgiFormat)
+			{
+			case DXGI_FORMAT_BC1_UNORM: image.Format = BlockFormat::BC1; break;
+			case DXGI_FORMAT_BC1_UNORM_SRGB: image.Format = BlockFormat::BC1; image.SRGB = true; break;
+			case DXGI_FORMAT_BC3_UNORM: image.Format = BlockFormat::BC3; break;
+			case DXGI_FORMAT_BC3_UNORM_SRGB: image.Format = BlockFormat::BC3; image.SRGB = true; break;
+			case DXGI_FORMAT_BC4_UNORM: image.Format = BlockFormat::BC4; break;
+			case DXGI_FORMAT_BC5_UNORM: image.Format = BlockFormat::BC5; break;
+			case DXGI_FORMAT_BC7_UNORM: image.Format = BlockFormat::BC7; break;
+			case DXGI_FORMAT_BC7_UNORM_SRGB: image.Format = BlockFormat::BC7; image.SRGB = true; break;
+			default:
+				error = "unsupported DXGI format " + std::to_string(dxgiFormat);
+				return false;
+			}
+			break;
+		}
+		default:
+			error = "unsupported DDS format";
+			return false;
+		}
+
+		if (image.Width <= 0 || image.Height <= 0 || image.Width > MaxCompressedImageSize || image.Height > MaxCompressedImageSize)
+		{
+			error = "invalid DDS size";
+			return false;
+		}
+
+		int levelCount = (flags & DDSD_MIPMAPCOUNT) && mipCount > 0 ? (int)mipCount : 1;
+		if (levelCount > MaxLevelCount(image.Width, image.Height))
+		{
+			error = "DDS has more mip levels than its size allows";
+			return false;
+		}
+
+		return LayoutLevels(data, size, offset, levelCount, image, error);
+	}
+
+	bool ParseKTX2(const unsigned char* data, size_t size, CompressedImage& image, std::string& error)
+	{
+		const size_t levelIndexOffset = 80;
+		if (size < levelIndexOffset)
+		{
+			error = "invalid KTX2 header";
+			return false;
+		}
+
+		uint32_t vkFormat = ReadValue<uint32_t>(data, 12);
+		image.Width = (int)ReadValue<uint32_t>(data, 20);
+		image.Height = (int)ReadValue<uint32_t>(data, 24);
+		uint32_t depth = ReadValue<uint32_t>(data, 28);
+		uint32_t layerCount = ReadValue<uint32_t>(data, 32);
+		uint32_t faceCount = ReadValue<uint32_t>(data, 36);
+		uint32_t levelCount = ReadValue<uint32_t>(data, 40);
+		uint32_t supercompression = ReadValue<uint32_t>(data, 44);
+
+		if (depth > 1 || layerCount > 1 || faceCount != 1 || image.Width <= 0 || image.Height <= 0)
+		{
+			error = "only 2D KTX2 textures are supported";
+			return false;
+		}
+		if (image.Width > MaxCompressedImageSize || image.Height > MaxCompressedImageSize)
+		{
+			error = "KTX2 texture is too large";
+			return false;
+		}
+		if (supercompression != 0)
+		{
+			error = "supercompressed KTX2 is not supported";
+			return false;
+		}
+
+		image.SRGB = false;
+		switch (vkFormat)
+		{
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK: image.Format = BlockFormat::BC1; break;
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: image.Format = BlockFormat::BC1; image.SRGB = true; break;
+		case VK_FORMAT_BC3_UNORM_BLOCK: image.Format = BlockFormat::BC3; break;
+		case VK_FORMAT_BC3_SRGB_BLOCK: image.Format = BlockFormat::BC3; image.SRGB = true; break;
+		case VK_FORMAT_BC4_UNORM_BLOCK: image.Format = BlockFormat::BC4; break;
+		case VK_FORMAT_BC5_UNORM_BLOCK: image.Format = BlockFormat::BC5; break;
+		case VK_FORMAT_BC7_UNORM_BLOCK: image.Format = BlockFormat::BC7; break;
+		case VK_FORMAT_BC7_SRGB_BLOCK: image.Format = BlockFormat::BC7; image.SRGB = true; break;
+		default:
+			error = "unsupported KTX2 format " + std::to_string(vkFormat);
+			return false;
+		}
+
+		/* 0 asks the loader to generate mips, only the base level is stored then. */
+		if (levelCount == 0)
+			levelCount = 1;
+		if ((int)levelCount > MaxLevelCount(image.Width, image.Height) || size < levelIndexOffset + levelCount * 24)
+		{
+			error = "invalid KTX2 level index";
+			return false;
+		}
+
+		/* The level index lists each level's offset and length, level 0 first. */
+		int width = image.Width;
+		int height = image.Height;
+		for (uint32_t i = 0; i < levelCount; i++)
+		{
+			uint64_t offset = ReadValue<uint64_t>(data, levelIndexOffset + i * 24);
+			uint64_t length = ReadValue<uint64_t>(data, levelIndexOffset + i * 24 + 8);
+			size_t levelSize = GetLevelSize(image.Format, width, height);
+
+			if (length != levelSize || offset > size || size - offset < length)
+			{
+				error = "invalid KTX2 level " + std::to_string(i);
+				return false;
+			}
+
+			image.Levels.push_back({ data + offset, (unsigned int)levelSize, width, height });
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+
+		return true;
+	}
+}
+
+bool IsCompressedImagePath(const std::string& path)
+{
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos)
+		return false;
+
+	std::string extension = path.substr(dot + 1);
+	for (char& c : extension)
+		c = (char)tolower((unsigned char)c);
+
+	return extension == "dds" || extension == "ktx2";
+}
+
+bool ParseCompressedImage(const unsigned char* data, size_t size, CompressedImage& image, std::string& error)
+{
+	image.Levels.clear();
+
+	if (size >= sizeof(KTX2Identifier) && memcmp(data, KTX2Identifier, sizeof(KTX2Identifier)) == 0)
+		return ParseKTX2(data, size, image, error);
+	if (size >= 4 && ReadValue<uint32_t>(data, 0) == DDSMagic)
+		return ParseDDS(data, size, image, error);
+
+	error = "not a DDS or KTX2 file";
+	return false;
+}
+
+unsigned int GetBlockBytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+}
+
+size_t GetLevelSize(BlockFormat format, int width, int height)
+{
+	/* 64 bit so sizes from a hostile header can't wrap before the caller's bounds checks. */
+	uint64_t blocksX = ((uint64_t)(unsigned int)width + 3) / 4;
+	uint64_t blocksY = ((uint64_t)(unsigned int)height + 3) / 4;
+	return (size_t)(blocksX * blocksY * GetBlockBytes(format));
+}
+
+unsigned int GetCompressedInternalFormat(BlockFormat format, bool srgb)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+	case BlockFormat::BC3: return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	case BlockFormat::BC4: return GL_COMPRESSED_RED_RGTC1;
+	case BlockFormat::BC5: return GL_COMPRESSED_RG_RGTC2;
+	case BlockFormat::BC7: return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+	}
+	return 0;
+}
+
+bool IsBlockFormatSupported(BlockFormat format)
+{
+	switch (format)
+	{
+	/* S3TC was patent encumbered and is still missing from some software implementations. */
+	case BlockFormat::BC1:
+	case BlockFormat::BC3: return GLEW_EXT_texture_compression_s3tc != 0;
+	case BlockFormat::BC4:
+	case BlockFormat::BC5: return GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc;
+	case BlockFormat::BC7: return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+	}
+	return false;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+/* Block compressed formats, all encode 4x4 pixel blocks. */
+enum class BlockFormat
+{
+	/* RGB with 1 bit alpha, 8 bytes per block. */
+	BC1,
+	/* RGBA, BC1 color plus BC4 alpha, 16 bytes per block. */
+	BC3,
+	/* Single channel, 8 bytes per block. */
+	BC4,
+	/* Two channels, two BC4 blocks, 16 bytes per block. */
+	BC5,
+	/* High quality RGBA, 16 bytes per block. */
+	BC7
+};
+
+struct CompressedLevel
+{
+	const unsigned char* Data;
+	unsigned int Size;
+	int Width, Height;
+};
+
+/* A 2D texture with its mip chain, the levels point into the parsed memory which has to outlive this. */
+struct CompressedImage
+{
+	BlockFormat Format;
+	bool SRGB;
+	int Width, Height;
+	/* Level 0 is the full size image. */
+	std::vector<CompressedLevel> Levels;
+};
+
+/* True for .dds and .ktx2 files, which are loaded without stb_image. */
+bool IsCompressedImagePath(const std::string& path);
+
+/* Reads a DDS or KTX2 container, recognised by its magic. Only uncompressed (not supercompressed)
+2D textures in the formats above are accepted, otherwise error explains why and false is returned. */
+bool ParseCompressedImage(const unsigned char* data, size_t size, CompressedImage& image, std::string& error);
+
+/* Largest width or height accepted from a file, GL 4.x guarantees at least this much texture size. */
+const int MaxCompressedImageSize = 16384;
+
+unsigned int GetBlockBytes(BlockFormat format);
+/* Bytes of a width * height level, partial blocks at the edges count as whole ones. */
+size_t GetLevelSize(BlockFormat format, int width, int height);
+/* Internal format for glCompressedTexImage2D. */
+unsigned int GetCompressedInternalFormat(BlockFormat format, bool srgb);
+/* Whether the current context samples format directly, if not it has to be decoded on the CPU. */
+bool IsBlockFormatSupported(BlockFormat format);
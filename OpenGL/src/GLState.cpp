@@ -0,0 +1,257 @@
+#include "GLState.h"
+#include "Renderer.h"
+
+/* Marks state that is not known, never a valid GL name. */
+static const unsigned int Unknown = 0xffffffff;
+
+/* Buffer targets the cache knows about, anything else is passed straight through. */
+static const unsigned int s_BufferTargets[] = {
+	GL_ARRAY_BUFFER,
+	GL_ELEMENT_ARRAY_BUFFER,
+	GL_UNIFORM_BUFFER,
+	GL_PIXEL_UNPACK_BUFFER,
+	GL_COPY_READ_BUFFER,
+	GL_COPY_WRITE_BUFFER,
+	GL_DRAW_INDIRECT_BUFFER,
+	GL_SHADER_STORAGE_BUFFER,
+};
+static const unsigned int BufferTargetCount = sizeof(s_BufferTargets) / sizeof(s_BufferTargets[0]);
+
+struct StateCache
+{
+	unsigned int Program = Unknown;
+	unsigned int VertexArray = Unknown;
+	unsigned int Buffers[BufferTargetCount];
+	unsigned int ActiveTexture = Unknown;
+	unsigned int Textures[GLState::MaxTextureUnits];
+	/* Buffer, offset and size per uniform buffer binding point. */
+	unsigned int UniformBindings[GLState::MaxUniformBindings][3];
+	int Blend = -1;
+	unsigned int BlendSrc = Unknown;
+	unsigned int BlendDst = Unknown;
+
+	StateCache()
+	{
+		for (unsigned int i = 0; i < BufferTargetCount; i++)
+			Buffers[i] = Unknown;
+		for (unsigned int i = 0; i < GLState::MaxTextureUnits; i++)
+			Textures[i] = Unknown;
+		for (unsigned int i = 0; i < GLState::MaxUniformBindings; i++)
+			UniformBindings[i][0] = UniformBindings[i][1] = UniformBindings[i][2] = Unknown;
+	}
+};
+
+static StateCache s_State;
+static GLState::Stats s_Stats;
+/* -1 until first asked, a context has to be current by then. Not part of the cache, Invalidate keeps it. */
+static int s_DirectStateAccess = -1;
+
+static int GetBufferTargetIndex(unsigned int target)
+{
+	for (unsigned int i = 0; i < BufferTargetCount; i++)
+	{
+		if (s_BufferTargets[i] == target)
+			return i;
+	}
+	return -1;
+}
+
+void GLState::UseProgram(unsigned int program)
+{
+	if (s_State.Program == program)
+	{
+		s_Stats.Skipped++;
+		return;
+	}
+
+	GLCall(glUseProgram(program));
+	s_State.Program = program;
+	s_Stats.Issued++;
+}
+
+void GLState::BindVertexArray(unsigned int vao)
+{
+	if (s_State.VertexArray == vao)
+	{
+		s_Stats.Skipped++;
+		return;
+	}
+
+	GLCall(glBindVertexArray(vao));
+	s_State.VertexArray = vao;
+	/* The element buffer comes with the VAO, we don't know which one that is. */
+	s_State.Buffers[GetBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = Unknown;
+	s_Stats.Issued++;
+}
+
+void GLState::BindBuffer(unsigned int target, unsigned int buffer)
+{
+	int index = GetBufferTargetIndex(target);
+	if (index != -1 && s_State.Buffers[index] == buffer)
+	{
+		s_Stats.Skipped++;
+		return;
+	}
+
+	GLCall(glBindBuffer(target, buffer));
+	if (index != -1)
+		s_State.Buffers[index] = buffer;
+	s_Stats.Issued++;
+}
+
+void GLState::BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, unsigned int offset, unsigned int size)
+{
+	unsigned int* binding = nullptr;
+	if (target == GL_UNIFORM_BUFFER && index < MaxUniformBindings)
+	{
+		binding = s_State.UniformBindings[index];
+		if (binding[0] == buffer && binding[1] == offset && binding[2] == size)
+		{
+			s_Stats.Skipped++;
+			return;
+		}
+	}
+
+	GLCall(glBindBufferRange(target, index, buffer, offset, size));
+	if (binding)
+	{
+		binding[0] = buffer;
+		binding[1] = offset;
+		binding[2] = size;
+	}
+
+	int generic = GetBufferTargetIndex(target);
+	if (generic != -1)
+		s_State.Buffers[generic] = buffer;
+	s_Stats.Issued++;
+}
+
+void GLState::BindTexture(unsigned int slot, unsigned int target, unsigned int texture)
+{
+	bool cached = target == GL_TEXTURE_2D && slot < MaxTextureUnits;
+	if (cached && s_State.Textures[slot] == texture)
+	{
+		s_Stats.Skipped++;
+		return;
+	}
+
+	if (s_State.ActiveTexture != slot)
+	{
+		GLCall(glActiveTexture(GL_TEXTURE0 + slot));
+		s_State.ActiveTexture = slot;
+		s_Stats.Issued++;
+	}
+
+	GLCall(glBindTexture(target, texture));
+	if (cached)
+		s_State.Textures[slot] = texture;
+	s_Stats.Issued++;
+}
+
+bool GLState::HasDirectStateAccess()
+{
+	if (s_DirectStateAccess == -1)
+		s_DirectStateAccess = GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access;
+	return s_DirectStateAccess == 1;
+}
+
+void GLState::SetDirectStateAccess(bool enabled)
+{
+	s_DirectStateAccess = enabled && (GLEW_VERSION_4_5 || GLEW_ARB_direct_state_access);
+}
+
+void GLState::SetBlend(bool enabled)
+{
+	if (s_State.Blend == (int)enabled)
+	{
+		s_Stats.Skipped++;
+		return;
+	}
+
+	if (enabled)
+	{
+		GLCall(glEnable(GL_BLEND));
+	}
+	else
+	{
+		GLCall(glDisable(GL_BLEND));
+	}
+	s_State.Blend = enabled;
+	s_Stats.Issued++;
+}
+
+bool GLState::IsBlendEnabled()
+{
+	if (s_State.Blend == -1)
+	{
+		GLCall(s_State.Blend = glIsEnabled(GL_BLEND) == GL_TRUE);
+	}
+	return s_State.Blend == 1;
+}
+
+void GLState::BlendFunc(unsigned int src, unsigned int dst)
+{
+	if (s_State.BlendSrc == src && s_State.BlendDst == dst)
+	{
+		s_Stats.Skipped++;
+		return;
+	}
+
+	GLCall(glBlendFunc(src, dst));
+	s_State.BlendSrc = src;
+	s_State.BlendDst = dst;
+	s_Stats.Issued++;
+}
+
+void GLState::ForgetProgram(unsigned int program)
+{
+	if (s_State.Program == program)
+		s_State.Program = Unknown;
+}
+
+void GLState::ForgetVertexArray(unsigned int vao)
+{
+	if (s_State.VertexArray == vao)
+	{
+		s_State.VertexArray = Unknown;
+		s_State.Buffers[GetBufferTargetIndex(GL_ELEMENT_ARRAY_BUFFER)] = Unknown;
+	}
+}
+
+void GLState::ForgetBuffer(unsigned int buffer)
+{
+	for (unsigned int i = 0; i < BufferTargetCount; i++)
+	{
+		if (s_State.Buffers[i] == buffer)
+			s_State.Buffers[i] = Unknown;
+	}
+	for (unsigned int i = 0; i < MaxUniformBindings; i++)
+	{
+		if (s_State.UniformBindings[i][0] == buffer)
+			s_State.UniformBindings[i][0] = Unknown;
+	}
+}
+
+void GLState::ForgetTexture(unsigned int texture)
+{
+	for (unsigned int i = 0; i < MaxTextureUnits; i++)
+	{
+		if (s_State.Textures[i] == texture)
+			s_State.Textures[i] = Unknown;
+	}
+}
+
+void GLState::Invalidate()
+{
+	s_State = StateCache();
+}
+
+const GLState::Stats& GLState::GetStats()
+{
+	return s_Stats;
+}
+
+void GLState::ResetStats()
+{
+	s_Stats = Stats();
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <GL/glew.h>
+
+/* Shadows the currently bound openGL state and skips calls that would not change anything.
+All binds and deletes of GL objects should go through here, code that talks to GL directly
+has to call Invalidate afterwards so the shadow copy is not trusted blindly. */
+class GLState
+{
+public:
+	struct Stats
+	{
+		unsigned int Issued = 0;
+		unsigned int Skipped = 0;
+	};
+
+	static const unsigned int MaxTextureUnits = 32;
+	static const unsigned int MaxUniformBindings = 16;
+
+	static void UseProgram(unsigned int program);
+	static void BindVertexArray(unsigned int vao);
+	/* Element array buffer binding is part of the VAO, it is tracked per bound VAO. */
+	static void BindBuffer(unsigned int target, unsigned int buffer);
+	/* Indexed binding, also replaces the generic binding of target like glBindBufferRange does.
+	Only GL_UNIFORM_BUFFER bindings are cached. */
+	static void BindBufferRange(unsigned int target, unsigned int index, unsigned int buffer, unsigned int offset, unsigned int size);
+	/* Only GL_TEXTURE_2D bindings are cached, other targets are always issued. */
+	static void BindTexture(unsigned int slot, unsigned int target, unsigned int texture);
+
+	/* True when the context has direct state access, core since 4.5. Resources are then created and
+	edited by name and never disturb the bindings cached here. */
+	static bool HasDirectStateAccess();
+	/* Switches to the bind to edit path even where DSA exists, e.g. to compare the two. Only call before
+	any resources exist, immutable storage made through one path can't be respecified by the other. */
+	static void SetDirectStateAccess(bool enabled);
+
+	static void SetBlend(bool enabled);
+	/* Asks GL once if the cached state is unknown. */
+	static bool IsBlendEnabled();
+	static void BlendFunc(unsigned int src, unsigned int dst);
+
+	/* Call before deleting a GL object so a recycled name is not mistaken for the current binding. */
+	static void ForgetProgram(unsigned int program);
+	static void ForgetVertexArray(unsigned int vao);
+	static void ForgetBuffer(unsigned int buffer);
+	static void ForgetTexture(unsigned int texture);
+
+	/* Forgets everything, the next call of each kind is always issued. */
+	static void Invalidate();
+
+	static const Stats& GetStats();
+	/* Call once per frame to get per frame counters. */
+	static void ResetStats();
+};
@@ -0,0 +1,245 @@
+#include "GeometryArena.h"
+#include "GLState.h"
+
+#include <algorithm>
+
+RangeAllocator::RangeAllocator(unsigned int capacity)
+	:m_Capacity(0), m_FreeSize(0)
+{
+	Reset(capacity);
+}
+
+void RangeAllocator::AddFree(unsigned int offset, unsigned int size)
+{
+	m_ByOffset[offset] = size;
+	m_BySize.emplace(size, offset);
+	m_FreeSize += size;
+}
+
+void RangeAllocator::RemoveFree(std::map<unsigned int, unsigned int>::iterator it)
+{
+	auto range = m_BySize.equal_range(it->second);
+	for (auto bySize = range.first; bySize != range.second; bySize++)
+	{
+		if (bySize->second == it->first)
+		{
+			m_BySize.erase(bySize);
+			break;
+		}
+	}
+	m_FreeSize -= it->second;
+	m_ByOffset.erase(it);
+}
+
+unsigned int RangeAllocator::Allocate(unsigned int size)
+{
+	auto bySize = m_BySize.lower_bound(size);
+	if (size == 0 || bySize == m_BySize.end())
+		return Invalid;
+
+	unsigned int offset = bySize->second;
+	unsigned int freeSize = bySize->first;
+	RemoveFree(m_ByOffset.find(offset));
+	if (freeSize > size)
+		AddFree(offset + size, freeSize - size);
+	return offset;
+}
+
+void RangeAllocator::Free(unsigned int offset, unsigned int size)
+{
+	ASSERT(size > 0 && offset + size <= m_Capacity);
+
+	auto next = m_ByOffset.lower_bound(offset);
+	ASSERT(next == m_ByOffset.end() || next->first >= offset + size);
+	if (next != m_ByOffset.end() && next->first == offset + size)
+	{
+		size += next->second;
+		auto merged = next++;
+		RemoveFree(merged);
+	}
+
+	if (next != m_ByOffset.begin())
+	{
+		auto previous = std::prev(next);
+		ASSERT(previous->first + previous->second <= offset);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			RemoveFree(previous);
+		}
+	}
+
+	AddFree(offset, size);
+}
+
+void RangeAllocator::Reset(unsigned int capacity, unsigned int used)
+{
+	m_ByOffset.clear();
+	m_BySize.clear();
+	m_Capacity = capacity;
+	m_FreeSize = 0;
+	if (used < capacity)
+		AddFree(used, capacity - used);
+}
+
+unsigned int RangeAllocator::GetLargestFree() const
+{
+	return m_BySize.empty() ? 0 : m_BySize.rbegin()->first;
+}
+
+GeometryArena::GeometryArena(const VertexLayoutView& layout, unsigned int vertexCapacity, unsigned int indexCapacity)
+	:m_Elements(layout.Elements, layout.Elements + layout.Count), m_Stride(layout.Stride)
+{
+	Rebuild(vertexCapacity, indexCapacity);
+}
+
+void GeometryArena::Rebuild(unsigned int vertexCapacity, unsigned int indexCapacity)
+{
+	VertexArray va;
+	auto vb = std::make_unique<VertexBuffer>(vertexCapacity * m_Stride);
+	auto ib = std::make_unique<IndexBuffer>(indexCapacity);
+	va.AddBuffer(*vb, VertexLayoutView(m_Elements.data(), (unsigned int)m_Elements.size(), m_Stride));
+	va.SetIndexBuffer(*ib);
+
+	unsigned int vertexCount = 0;
+	unsigned int indexCount = 0;
+	if (m_VertexBuffer)
+	{
+		for (auto& mesh : m_Meshes)
+		{
+			if (mesh.VertexCount == 0)
+				continue;
+			CopyBufferRange(m_VertexBuffer->GetRendererID(), vb->GetRendererID(),
+				mesh.BaseVertex * m_Stride, vertexCount * m_Stride, mesh.VertexCount * m_Stride);
+			mesh.BaseVertex = (int)vertexCount;
+			vertexCount += mesh.VertexCount;
+		}
+
+		for (auto& mesh : m_Meshes)
+		{
+			if (mesh.VertexCount == 0)
+				continue;
+			CopyBufferRange(m_IndexBuffer->GetRendererID(), ib->GetRendererID(),
+				mesh.FirstIndex * sizeof(unsigned int), indexCount * sizeof(unsigned int), mesh.IndexCount * sizeof(unsigned int));
+			mesh.FirstIndex = indexCount;
+			indexCount += mesh.IndexCount;
+		}
+	}
+
+	m_VertexArray = std::move(va);
+	m_VertexBuffer = std::move(vb);
+	m_IndexBuffer = std::move(ib);
+	m_Vertices.Reset(vertexCapacity, vertexCount);
+	m_Indices.Reset(indexCapacity, indexCount);
+}
+
+GeometryArena::MeshHandle GeometryArena::Allocate(const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount)
+{
+	ASSERT(vertexCount > 0 && indexCount > 0);
+
+	unsigned int firstVertex = m_Vertices.Allocate(vertexCount);
+	unsigned int firstIndex = m_Indices.Allocate(indexCount);
+	if (firstVertex == RangeAllocator::Invalid || firstIndex == RangeAllocator::Invalid)
+	{
+		if (firstVertex != RangeAllocator::Invalid)
+			m_Vertices.Free(firstVertex, vertexCount);
+		if (firstIndex != RangeAllocator::Invalid)
+			m_Indices.Free(firstIndex, indexCount);
+
+		/* Compacting is enough when the free space is only fragmented, otherwise grow. */
+		unsigned int vertexCapacity = m_Vertices.GetCapacity();
+		unsigned int indexCapacity = m_Indices.GetCapacity();
+		bool grow = false;
+		if (m_Vertices.GetFreeSize() < vertexCount)
+		{
+			vertexCapacity = std::max(vertexCapacity * 2, vertexCapacity - m_Vertices.GetFreeSize() + vertexCount);
+			grow = true;
+		}
+		if (m_Indices.GetFreeSize() < indexCount)
+		{
+			indexCapacity = std::max(indexCapacity * 2, indexCapacity - m_Indices.GetFreeSize() + indexCount);
+			grow = true;
+		}
+
+		Rebuild(vertexCapacity, indexCapacity);
+		if (grow)
+			m_Stats.Grows++;
+		else
+			m_Stats.Defragments++;
+
+		firstVertex = m_Vertices.Allocate(vertexCount);
+		firstIndex = m_Indices.Allocate(indexCount);
+		ASSERT(firstVertex != RangeAllocator::Invalid && firstIndex != RangeAllocator::Invalid);
+	}
+
+	SetBufferSubData(m_VertexBuffer->GetRendererID(), GL_COPY_WRITE_BUFFER, firstVertex * m_Stride, vertexCount * m_Stride, vertices);
+	SetBufferSubData(m_IndexBuffer->GetRendererID(), GL_COPY_WRITE_BUFFER, firstIndex * (unsigned int)sizeof(unsigned int),
+		indexCount * (unsigned int)sizeof(unsigned int), indices);
+
+	MeshHandle handle;
+	if (!m_FreeHandles.empty())
+	{
+		handle = m_FreeHandles.back();
+		m_FreeHandles.pop_back();
+	}
+	else
+	{
+		m_Meshes.emplace_back();
+		handle = (MeshHandle)m_Meshes.size();
+	}
+
+	MeshRange& mesh = m_Meshes[handle - 1];
+	mesh.BaseVertex = (int)firstVertex;
+	mesh.FirstIndex = firstIndex;
+	mesh.IndexCount = indexCount;
+	mesh.VertexCount = vertexCount;
+	m_Stats.Meshes++;
+	return handle;
+}
+
+void GeometryArena::Free(MeshHandle mesh)
+{
+	ASSERT(mesh > 0 && mesh <= m_Meshes.size() && m_Meshes[mesh - 1].VertexCount > 0);
+
+	MeshRange& range = m_Meshes[mesh - 1];
+	m_Vertices.Free((unsigned int)range.BaseVertex, range.VertexCount);
+	m_Indices.Free(range.FirstIndex, range.IndexCount);
+	range = MeshRange();
+	m_FreeHandles.push_back(mesh);
+	m_Stats.Meshes--;
+}
+
+void GeometryArena::Defragment()
+{
+	Rebuild(m_Vertices.GetCapacity(), m_Indices.GetCapacity());
+	m_Stats.Defragments++;
+}
+
+const GeometryArena::MeshRange& GeometryArena::GetRange(MeshHandle mesh) const
+{
+	ASSERT(mesh > 0 && mesh <= m_Meshes.size());
+	return m_Meshes[mesh - 1];
+}
+
+RenderCommand GeometryArena::MakeCommand(MeshHandle mesh, Shader& shader, const glm::mat4& model, const Texture* texture) const
+{
+	const MeshRange& range = GetRange(mesh);
+	RenderCommand command;
+	command.SortKey = 0;
+	command.VAO = &m_VertexArray;
+	command.IBO = m_IndexBuffer.get();
+	command.Program = &shader;
+	command.Tex = texture;
+	command.Model = model;
+	command.FirstIndex = range.FirstIndex;
+	command.IndexCount = range.IndexCount;
+	command.BaseVertex = range.BaseVertex;
+	return command;
+}
+
+void GeometryArena::Draw(const Renderer& renderer, MeshHandle mesh, const Shader& shader) const
+{
+	const MeshRange& range = GetRange(mesh);
+	renderer.DrawRange(m_VertexArray, *m_IndexBuffer, shader, range.FirstIndex, range.IndexCount, range.BaseVertex);
+}
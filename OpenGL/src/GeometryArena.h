@@ -0,0 +1,111 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Renderer.h"
+#include "VertexBuffer.h"
+#include "VertexBufferLayout.h"
+
+class Texture;
+
+/* Hands out [offset, offset + size) ranges of a fixed capacity, best fit from a free list.
+Freed ranges merge with free neighbours so the list stays short. */
+class RangeAllocator
+{
+public:
+	static const unsigned int Invalid = 0xffffffff;
+
+private:
+	/* Free ranges by offset for merging, and by size for best fit. */
+	std::map<unsigned int, unsigned int> m_ByOffset;
+	std::multimap<unsigned int, unsigned int> m_BySize;
+	unsigned int m_Capacity;
+	unsigned int m_FreeSize;
+
+	void AddFree(unsigned int offset, unsigned int size);
+	void RemoveFree(std::map<unsigned int, unsigned int>::iterator it);
+
+public:
+	explicit RangeAllocator(unsigned int capacity = 0);
+
+	/* Returns the offset of the range, Invalid if no free range is large enough. */
+	unsigned int Allocate(unsigned int size);
+	void Free(unsigned int offset, unsigned int size);
+	/* Everything below used is allocated, the rest is one free range. */
+	void Reset(unsigned int capacity, unsigned int used = 0);
+
+	inline unsigned int GetCapacity() const { return m_Capacity; }
+	inline unsigned int GetFreeSize() const { return m_FreeSize; }
+	inline unsigned int GetFreeRangeCount() const { return (unsigned int)m_ByOffset.size(); }
+	unsigned int GetLargestFree() const;
+};
+
+/* Many meshes of one vertex layout in a single vertex buffer and a single index buffer, so they all draw
+through one vertex array without rebinding. Meshes are found by base vertex and first index, indices stay
+relative to the mesh's own vertices. When a mesh doesn't fit the arena compacts itself, growing if it has to.
+Compacting moves meshes, so don't Allocate or Defragment between Renderer::Submit and Flush. */
+class GeometryArena
+{
+public:
+	/* 0 is never a valid handle. */
+	typedef unsigned int MeshHandle;
+
+	struct MeshRange
+	{
+		int BaseVertex = 0;
+		unsigned int FirstIndex = 0;
+		unsigned int IndexCount = 0;
+		/* 0 for freed handles. */
+		unsigned int VertexCount = 0;
+	};
+
+	struct Stats
+	{
+		unsigned int Meshes = 0;
+		unsigned int Defragments = 0;
+		unsigned int Grows = 0;
+	};
+
+private:
+	std::vector<VertexBufferElement> m_Elements;
+	unsigned int m_Stride;
+
+	VertexArray m_VertexArray;
+	std::unique_ptr<VertexBuffer> m_VertexBuffer;
+	std::unique_ptr<IndexBuffer> m_IndexBuffer;
+
+	RangeAllocator m_Vertices;
+	RangeAllocator m_Indices;
+
+	std::vector<MeshRange> m_Meshes;
+	std::vector<MeshHandle> m_FreeHandles;
+	Stats m_Stats;
+
+	/* Copies every live mesh to the start of new buffers of the given capacity. */
+	void Rebuild(unsigned int vertexCapacity, unsigned int indexCapacity);
+
+public:
+	GeometryArena(const VertexLayoutView& layout, unsigned int vertexCapacity = 65536, unsigned int indexCapacity = 196608);
+
+	GeometryArena(const GeometryArena&) = delete;
+	GeometryArena& operator=(const GeometryArena&) = delete;
+
+	/* vertices holds vertexCount vertices in the arena's layout, indices count from 0 for this mesh. */
+	MeshHandle Allocate(const void* vertices, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount);
+	void Free(MeshHandle mesh);
+	/* Packs the live meshes together so freed holes become one free range, needs room for a second copy while it runs. */
+	void Defragment();
+
+	const MeshRange& GetRange(MeshHandle mesh) const;
+	/* Draw command for mesh, ready for Renderer::Submit. Commands from one arena with the same model merge into one multi-draw. */
+	RenderCommand MakeCommand(MeshHandle mesh, Shader& shader, const glm::mat4& model, const Texture* texture = nullptr) const;
+	void Draw(const Renderer& renderer, MeshHandle mesh, const Shader& shader) const;
+
+	inline const VertexArray& GetVertexArray() const { return m_VertexArray; }
+	inline const IndexBuffer& GetIndexBuffer() const { return *m_IndexBuffer; }
+	inline const RangeAllocator& GetVertexAllocator() const { return m_Vertices; }
+	inline const RangeAllocator& GetIndexAllocator() const { return m_Indices; }
+	inline const Stats& GetStats() const { return m_Stats; }
+};
@@ -1,32 +1,207 @@
 #include "IndexBuffer.h"
 #include "Renderer.h"
+#include "GLState.h"
+#include "VertexArrayCache.h"
 
-IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count)
-    :m_Count(count)
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/* Returns data as type, narrowed into scratch unless it is 32 bit already. The caller has checked the indices fit. */
+static const void* PackIndices(const unsigned int* data, unsigned int count, unsigned int type, std::vector<unsigned char>& scratch)
+{
+    if (type == GL_UNSIGNED_INT)
+        return data;
+
+    scratch.resize(count * IndexBuffer::GetIndexSize(type));
+    if (type == GL_UNSIGNED_BYTE)
+    {
+        for (unsigned int i = 0; i < count; i++)
+            scratch[i] = (uint8_t)data[i];
+    }
+    else
+    {
+        uint16_t* narrow = (uint16_t*)scratch.data();
+        for (unsigned int i = 0; i < count; i++)
+            narrow[i] = (uint16_t)data[i];
+    }
+    return scratch.data();
+}
+
+static unsigned int GetMaxIndex(const unsigned int* data, unsigned int count)
+{
+    return count > 0 ? *std::max_element(data, data + count) : 0;
+}
+
+IndexBuffer::IndexBuffer(const unsigned int* data, unsigned int count, BufferUsage usage)
+    :m_Count(count), m_Capacity(count), m_Usage(GetGLBufferUsage(usage)), m_Pending(usage != BufferUsage::Static)
 {
 
     /* Possibility these won't be equal which could cause buffer sizing issues. */
     ASSERT(sizeof(unsigned int) == sizeof(GLuint));
 
-    /* Generate buffer that openGL will draw from and assigns ID to the unsigned int address. */
-    GLCall(glGenBuffers(1, &m_RenderID));
-    /* Set use of Buffer and bind buffer to ID. */
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RenderID));
+    m_Type = GetIndexType(GetMaxIndex(data, count));
+    std::vector<unsigned char> scratch;
+    const void* packed = PackIndices(data, count, m_Type, scratch);
+
+    /* Generate buffer that openGL will draw from and assigns ID to the unsigned int address. Without direct
+    state access it is made through the copy target, GL_ELEMENT_ARRAY_BUFFER would attach it to the bound VAO. */
+    m_RenderID = CreateBuffer(GL_COPY_WRITE_BUFFER);
     /* Creates and initializes a buffer object's data store. */
-    GLCall(glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), data, GL_STATIC_DRAW));
+    SetBufferData(m_RenderID, GL_COPY_WRITE_BUFFER, count * GetIndexSize(), packed, m_Usage);
+    m_Pending.Seed(packed, count * GetIndexSize(), count * GetIndexSize());
+}
+
+IndexBuffer::IndexBuffer(unsigned int count, unsigned int type, BufferUsage usage)
+    :m_Count(count), m_Capacity(count), m_Type(type), m_Usage(GetGLBufferUsage(usage)), m_Pending(usage != BufferUsage::Static)
+{
+    m_RenderID = CreateBuffer(GL_COPY_WRITE_BUFFER);
+    SetBufferData(m_RenderID, GL_COPY_WRITE_BUFFER, count * GetIndexSize(), nullptr, m_Usage);
+    m_Pending.Seed(nullptr, 0, count * GetIndexSize());
 }
 
 IndexBuffer::~IndexBuffer()
 {
+    Release();
+}
+
+IndexBuffer::IndexBuffer(IndexBuffer&& other) noexcept
+    :m_RenderID(other.m_RenderID), m_Count(other.m_Count), m_Capacity(other.m_Capacity), m_Type(other.m_Type),
+    m_Usage(other.m_Usage), m_Pending(std::move(other.m_Pending))
+{
+    other.m_RenderID = 0;
+    other.m_Count = 0;
+    other.m_Capacity = 0;
+}
+
+IndexBuffer& IndexBuffer::operator=(IndexBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        m_RenderID = other.m_RenderID;
+        m_Count = other.m_Count;
+        m_Capacity = other.m_Capacity;
+        m_Type = other.m_Type;
+        m_Usage = other.m_Usage;
+        m_Pending = std::move(other.m_Pending);
+        other.m_RenderID = 0;
+        other.m_Count = 0;
+        other.m_Capacity = 0;
+    }
+    return *this;
+}
+
+void IndexBuffer::Release()
+{
+    if (m_RenderID == 0)
+        return;
+
+    GLState::ForgetBuffer(m_RenderID);
+    VertexArrayCache::ForgetBufferEverywhere(m_RenderID);
     GLCall(glDeleteBuffers(1, &m_RenderID));
+    m_RenderID = 0;
+}
+
+void IndexBuffer::SetData(const unsigned int* data, unsigned int count)
+{
+    m_Pending.Clear();
+
+    unsigned int type = GetIndexType(GetMaxIndex(data, count));
+    bool widen = GetIndexSize(type) > GetIndexSize();
+    if (widen)
+        m_Type = type;
+
+    std::vector<unsigned char> scratch;
+    const void* packed = PackIndices(data, count, m_Type, scratch);
+
+    /* Updates go through the copy target, binding GL_ELEMENT_ARRAY_BUFFER would change the bound vertex array. */
+    if (widen || count >= m_Capacity)
+    {
+        m_Capacity = count > m_Capacity ? count : m_Capacity;
+        SetBufferData(m_RenderID, GL_COPY_WRITE_BUFFER, m_Capacity * GetIndexSize(), count == m_Capacity ? packed : nullptr, m_Usage);
+        if (count < m_Capacity)
+            SetBufferSubData(m_RenderID, GL_COPY_WRITE_BUFFER, 0, count * GetIndexSize(), packed);
+    }
+    else
+    {
+        /* Orphan first, the driver hands out fresh storage instead of syncing with the GPU. */
+        SetBufferData(m_RenderID, GL_COPY_WRITE_BUFFER, m_Capacity * GetIndexSize(), nullptr, m_Usage);
+        SetBufferSubData(m_RenderID, GL_COPY_WRITE_BUFFER, 0, count * GetIndexSize(), packed);
+    }
+    m_Pending.Seed(packed, count * GetIndexSize(), m_Capacity * GetIndexSize());
+    m_Count = count;
+}
+
+void IndexBuffer::SetSubData(const unsigned int* data, unsigned int count, unsigned int firstIndex)
+{
+    ASSERT(firstIndex + count <= m_Capacity);
+    ASSERT(GetIndexSize(GetIndexType(GetMaxIndex(data, count))) <= GetIndexSize());
+
+    std::vector<unsigned char> scratch;
+    const void* packed = PackIndices(data, count, m_Type, scratch);
+    /* Queued writes are older, they must not land on top of this one later. */
+    FlushUpdates();
+    SetBufferSubData(m_RenderID, GL_COPY_WRITE_BUFFER, firstIndex * GetIndexSize(), count * GetIndexSize(), packed);
+    m_Pending.Mirror(packed, count * GetIndexSize(), firstIndex * GetIndexSize());
+}
+
+void IndexBuffer::QueueSubData(const unsigned int* data, unsigned int count, unsigned int firstIndex)
+{
+    ASSERT(firstIndex + count <= m_Capacity);
+    ASSERT(GetIndexSize(GetIndexType(GetMaxIndex(data, count))) <= GetIndexSize());
+
+    std::vector<unsigned char> scratch;
+    const void* packed = PackIndices(data, count, m_Type, scratch);
+    m_Pending.Write(packed, count * GetIndexSize(), firstIndex * GetIndexSize());
+}
+
+unsigned int IndexBuffer::FlushUpdates()
+{
+    return m_Pending.Upload(m_RenderID, m_Capacity * GetIndexSize(), m_Usage);
+}
+
+void IndexBuffer::Invalidate()
+{
+    m_Pending.Clear();
+    if (GLEW_VERSION_4_3 || GLEW_ARB_invalidate_subdata)
+    {
+        GLCall(glInvalidateBufferData(m_RenderID));
+    }
+    else
+    {
+        SetBufferData(m_RenderID, GL_COPY_WRITE_BUFFER, m_Capacity * GetIndexSize(), nullptr, m_Usage);
+    }
 }
 
 void IndexBuffer::Bind() const
 {
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RenderID));
+    GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_RenderID);
 }
 
 void IndexBuffer::Unbind() const
 {
-    GLCall(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+    GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+unsigned int IndexBuffer::GetIndexSize(unsigned int type)
+{
+    switch (type)
+    {
+        case GL_UNSIGNED_BYTE:  return 1;
+        case GL_UNSIGNED_SHORT: return 2;
+        case GL_UNSIGNED_INT:   return 4;
+    }
+
+    ASSERT(false);
+    return 0;
+}
+
+unsigned int IndexBuffer::GetIndexType(unsigned int maxIndex)
+{
+    if (maxIndex <= 0xff)
+        return GL_UNSIGNED_BYTE;
+    if (maxIndex <= 0xffff)
+        return GL_UNSIGNED_SHORT;
+    return GL_UNSIGNED_INT;
 }
@@ -1,18 +1,61 @@
 #pragma once
 
+#include <GL/glew.h>
+
+#include "BufferUpdate.h"
+
 class IndexBuffer
 {
 private:
-	/* Id for openGl sate machine. */
+	/* Id for openGl sate machine, 0 once moved from. */
 	unsigned int m_RenderID;
 	unsigned int m_Count;
+	/* Indices the storage has room for. */
+	unsigned int m_Capacity;
+	/* GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, draws have to pass it on. */
+	unsigned int m_Type;
+	unsigned int m_Usage;
+	PendingBufferUpdates m_Pending;
+
+	void Release();
 public:
-	/* count means element count. */
-	IndexBuffer(const unsigned int* data, unsigned int count);
+	/* count means element count. Stored in the smallest type that holds the largest index. */
+	IndexBuffer(const unsigned int* data, unsigned int count, BufferUsage usage = BufferUsage::Static);
+	/* Allocates room for count indices of type to be filled later, GetCount reports the capacity. */
+	explicit IndexBuffer(unsigned int count, unsigned int type = GL_UNSIGNED_INT, BufferUsage usage = BufferUsage::Dynamic);
 	~IndexBuffer();
 
+	/* Move only, a copy would delete the same GL buffer twice. */
+	IndexBuffer(const IndexBuffer&) = delete;
+	IndexBuffer& operator=(const IndexBuffer&) = delete;
+	IndexBuffer(IndexBuffer&& other) noexcept;
+	IndexBuffer& operator=(IndexBuffer&& other) noexcept;
+
+	/* Replaces the contents with count indices and makes count the draw count, growing the buffer if needed.
+	The type only ever widens, to the smallest one holding the largest index. The old storage is orphaned
+	so the upload doesn't wait for draws still reading it. Queued updates are dropped. */
+	void SetData(const unsigned int* data, unsigned int count);
+	/* Overwrites count indices from firstIndex on right away, they have to fit the current type.
+	Queued updates are uploaded first so writes land in order. */
+	void SetSubData(const unsigned int* data, unsigned int count, unsigned int firstIndex);
+	/* Same, but only recorded until FlushUpdates, which merges nearby writes into one upload each.
+	Dynamic and stream buffers keep a CPU copy of their contents so writes with small gaps between them merge as well. */
+	void QueueSubData(const unsigned int* data, unsigned int count, unsigned int firstIndex);
+	/* Uploads the queued updates, call before drawing from the buffer. Returns the number of uploads made. */
+	unsigned int FlushUpdates();
+	/* Tells the driver the contents are no longer needed, before rewriting all of it piece by piece. */
+	void Invalidate();
+
 	void Bind() const;
 	void Unbind() const;
 
+	inline unsigned int GetRendererID() const { return m_RenderID; }
 	inline unsigned int GetCount() const { return m_Count; }
+	inline unsigned int GetType() const { return m_Type; }
+	/* Bytes per index, FirstIndex style offsets are multiplied by it. */
+	inline unsigned int GetIndexSize() const { return GetIndexSize(m_Type); }
+
+	static unsigned int GetIndexSize(unsigned int type);
+	/* Smallest type that can hold maxIndex. */
+	static unsigned int GetIndexType(unsigned int maxIndex);
 };
\ No newline at end of file
@@ -0,0 +1,203 @@
+#include "MeshOptimizer.h"
+#include "Renderer.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	/* Tuning from Forsyth's paper, the simulated cache is LRU. */
+	const int CacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	/* Vertices in the cache score by how recently they were used, the three of the last triangle get a fixed score
+	so the next one doesn't just reuse the same edge. Vertices with few triangles left get a boost to finish them off. */
+	float VertexScore(int cachePosition, unsigned int remaining)
+	{
+		if (remaining == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+				score = LastTriangleScore;
+			else
+				score = powf(1.0f - (float)(cachePosition - 3) / (CacheSize - 3), CacheDecayPower);
+		}
+		return score + ValenceBoostScale * powf((float)remaining, -ValenceBoostPower);
+	}
+}
+
+float ComputeACMR(const unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int cacheSize)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return 0.0f;
+
+	/* A vertex is in the FIFO if fewer than cacheSize misses came after the one that brought it in,
+	enteredAt holds the miss count right after that miss and 0 for vertices never seen. */
+	std::vector<size_t> enteredAt(vertexCount, 0);
+	size_t misses = 0;
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		unsigned int v = indices[i];
+		ASSERT(v < vertexCount);
+		if (enteredAt[v] == 0 || misses - enteredAt[v] >= cacheSize)
+		{
+			misses++;
+			enteredAt[v] = misses;
+		}
+	}
+	return (float)misses / triangleCount;
+}
+
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, unsigned int vertexCount)
+{
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	/* Triangles using each vertex, the live ones are the first remaining[v] entries of its range. */
+	std::vector<unsigned int> remaining(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		ASSERT(indices[i] < vertexCount);
+		remaining[indices[i]]++;
+	}
+
+	std::vector<size_t> offsets(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + remaining[v];
+
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+		adjacency[cursor[indices[i]]++] = (unsigned int)(i / 3);
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++)
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<bool> emitted(triangleCount, false);
+
+	std::vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+
+	/* Cache holds CacheSize vertices plus room for the three pushed in front of it. */
+	unsigned int cache[CacheSize + 3];
+	unsigned int cacheCount = 0;
+	/* When no cached vertex has triangles left, continue with the next triangle in input order. */
+	size_t nextUnemitted = 0;
+	long long best = -1;
+
+	for (size_t n = 0; n < triangleCount; n++)
+	{
+		if (best < 0)
+		{
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			best = (long long)nextUnemitted;
+		}
+
+		const unsigned int* triangle = indices + best * 3;
+		emitted[(size_t)best] = true;
+		output.insert(output.end(), triangle, triangle + 3);
+
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int v = triangle[k];
+			unsigned int* list = adjacency.data() + offsets[v];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				if (list[j] == (unsigned int)best)
+				{
+					list[j] = list[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		/* The triangle's vertices move to the front, everything else shifts back. */
+		unsigned int newCache[CacheSize + 3];
+		unsigned int newCount = 0;
+		for (int k = 0; k < 3; k++)
+			newCache[newCount++] = triangle[k];
+		for (unsigned int i = 0; i < cacheCount; i++)
+		{
+			unsigned int v = cache[i];
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+				newCache[newCount++] = v;
+		}
+
+		for (unsigned int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			cachePosition[v] = i < (unsigned int)CacheSize ? (int)i : -1;
+			vertexScore[v] = VertexScore(cachePosition[v], remaining[v]);
+		}
+
+		/* Only triangles touching a vertex whose score changed need rescoring, the best of them goes next. */
+		best = -1;
+		float bestScore = -1.0f;
+		for (unsigned int i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			const unsigned int* list = adjacency.data() + offsets[v];
+			for (unsigned int j = 0; j < remaining[v]; j++)
+			{
+				unsigned int t = list[j];
+				float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+				if (score > bestScore)
+				{
+					bestScore = score;
+					best = t;
+				}
+			}
+		}
+
+		cacheCount = newCount < (unsigned int)CacheSize ? newCount : (unsigned int)CacheSize;
+		memcpy(cache, newCache, cacheCount * sizeof(unsigned int));
+	}
+
+	memcpy(indices, output.data(), output.size() * sizeof(unsigned int));
+}
+
+unsigned int OptimizeVertexFetch(void* vertices, unsigned int vertexCount, unsigned int vertexSize, unsigned int* indices, size_t indexCount)
+{
+	const unsigned int Unused = 0xffffffff;
+	std::vector<unsigned int> remap(vertexCount, Unused);
+	unsigned int next = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int& target = remap[indices[i]];
+		if (target == Unused)
+			target = next++;
+		indices[i] = target;
+	}
+
+	unsigned char* data = (unsigned char*)vertices;
+	std::vector<unsigned char> original(data, data + (size_t)vertexCount * vertexSize);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		if (remap[v] != Unused)
+			memcpy(data + (size_t)remap[v] * vertexSize, original.data() + (size_t)v * vertexSize, vertexSize);
+	}
+	return next;
+}
+
+MeshOptimizationReport OptimizeMesh(void* vertices, unsigned int vertexCount, unsigned int vertexSize, unsigned int* indices, size_t indexCount)
+{
+	MeshOptimizationReport report;
+	report.ACMRBefore = ComputeACMR(indices, indexCount, vertexCount);
+	OptimizeVertexCache(indices, indexCount, vertexCount);
+	report.VertexCount = OptimizeVertexFetch(vertices, vertexCount, vertexSize, indices, indexCount);
+	report.ACMRAfter = ComputeACMR(indices, indexCount, report.VertexCount);
+	return report;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+/* Import time passes over indexed triangle lists, run them once on a mesh before creating its buffers.
+Indices are 32 bit here, IndexBuffer narrows them afterwards. */
+
+/* Average cache miss ratio: vertices transformed per triangle with a FIFO post-transform cache of cacheSize entries.
+0.5 is the best possible for a large regular grid, 3 means every vertex is transformed again for every triangle. */
+float ComputeACMR(const unsigned int* indices, size_t indexCount, unsigned int vertexCount, unsigned int cacheSize = 16);
+
+/* Reorders the triangles so consecutive ones reuse recently transformed vertices (Forsyth's linear speed algorithm).
+Only the triangle order changes, every triangle keeps its winding. */
+void OptimizeVertexCache(unsigned int* indices, size_t indexCount, unsigned int vertexCount);
+
+/* Reorders the vertices into the order the indices first use them so fetches walk the vertex buffer forwards,
+and rewrites the indices to match. Unreferenced vertices are dropped, returns the new vertex count. */
+unsigned int OptimizeVertexFetch(void* vertices, unsigned int vertexCount, unsigned int vertexSize, unsigned int* indices, size_t indexCount);
+
+struct MeshOptimizationReport
+{
+	float ACMRBefore = 0.0f;
+	float ACMRAfter = 0.0f;
+	unsigned int VertexCount = 0;
+};
+
+/* Runs OptimizeVertexCache then OptimizeVertexFetch and measures the ACMR around them. */
+MeshOptimizationReport OptimizeMesh(void* vertices, unsigned int vertexCount, unsigned int vertexSize, unsigned int* indices, size_t indexCount);
@@ -0,0 +1,69 @@
+#include "MeshQuantizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "glm/gtc/packing.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+static glm::i16vec4 QuantizeSNorm16(const glm::vec4& v)
+{
+	return glm::i16vec4(glm::round(glm::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+QuantizedMesh QuantizeMesh(const MeshVertex* vertices, size_t count)
+{
+	QuantizedMesh mesh;
+	mesh.Center = glm::vec3(0.0f);
+	mesh.Extent = glm::vec3(1.0f);
+
+	if (count > 0)
+	{
+		glm::vec3 minimum = vertices[0].Position;
+		glm::vec3 maximum = vertices[0].Position;
+		for (size_t i = 1; i < count; i++)
+		{
+			minimum = glm::min(minimum, vertices[i].Position);
+			maximum = glm::max(maximum, vertices[i].Position);
+		}
+		mesh.Center = (minimum + maximum) * 0.5f;
+		/* A flat axis would divide by zero, any extent maps it to 0 anyway. */
+		mesh.Extent = glm::max((maximum - minimum) * 0.5f, glm::vec3(1e-6f));
+	}
+	mesh.Dequantize = glm::scale(glm::translate(glm::mat4(1.0f), mesh.Center), mesh.Extent);
+
+	mesh.Vertices.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const MeshVertex& in = vertices[i];
+		QuantizedVertex& out = mesh.Vertices[i];
+
+		out.Position.Value = QuantizeSNorm16(glm::vec4((in.Position - mesh.Center) / mesh.Extent, 1.0f));
+
+		float length = glm::length(in.Normal);
+		glm::vec3 normal = length > 0.0f ? in.Normal / length : glm::vec3(0.0f);
+		out.Normal.Value = glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+
+		out.TexCoord.Value = glm::u16vec2(glm::packHalf1x16(in.TexCoord.x), glm::packHalf1x16(in.TexCoord.y));
+	}
+	return mesh;
+}
+
+MeshVertex DequantizeVertex(const QuantizedMesh& mesh, const QuantizedVertex& vertex)
+{
+	MeshVertex out;
+	/* GL maps -32768 and -32767 both to -1. */
+	glm::vec3 position = glm::max(glm::vec3(vertex.Position.Value) / 32767.0f, glm::vec3(-1.0f));
+	out.Position = mesh.Center + position * mesh.Extent;
+	out.Normal = glm::vec3(glm::unpackSnorm3x10_1x2(vertex.Normal.Value));
+	out.TexCoord = glm::vec2(glm::unpackHalf1x16(vertex.TexCoord.Value.x), glm::unpackHalf1x16(vertex.TexCoord.Value.y));
+	return out;
+}
+
+float GetMaxPositionError(const MeshVertex* vertices, size_t count, const QuantizedMesh& mesh)
+{
+	float error = 0.0f;
+	for (size_t i = 0; i < count && i < mesh.Vertices.size(); i++)
+		error = std::max(error, glm::length(vertices[i].Position - DequantizeVertex(mesh, mesh.Vertices[i]).Position));
+	return error;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <vector>
+
+#include "glm/glm.hpp"
+#include "VertexBufferLayout.h"
+
+/* Float vertex as it comes out of a model loader, 32 bytes. */
+struct MeshVertex
+{
+	glm::vec3 Position;
+	glm::vec3 Normal;
+	glm::vec2 TexCoord;
+};
+
+static constexpr auto MeshVertexLayout = MakeVertexLayout<MeshVertex>(
+	VERTEX_ATTRIBUTE(MeshVertex, Position),
+	VERTEX_ATTRIBUTE(MeshVertex, Normal),
+	VERTEX_ATTRIBUTE(MeshVertex, TexCoord));
+
+/* Same vertex in 16 bytes. Position is relative to the mesh bounds, w is always 1. */
+struct QuantizedVertex
+{
+	SNorm16x4 Position;
+	PackedNormal Normal;
+	Half2 TexCoord;
+};
+
+static constexpr auto QuantizedVertexLayout = MakeVertexLayout<QuantizedVertex>(
+	VERTEX_ATTRIBUTE(QuantizedVertex, Position),
+	VERTEX_ATTRIBUTE(QuantizedVertex, Normal),
+	VERTEX_ATTRIBUTE(QuantizedVertex, TexCoord));
+
+struct QuantizedMesh
+{
+	std::vector<QuantizedVertex> Vertices;
+	/* Bounds the positions were quantized against. */
+	glm::vec3 Center;
+	glm::vec3 Extent;
+	/* Takes quantized positions back to model space, multiply it into the model matrix so shaders don't change. */
+	glm::mat4 Dequantize;
+};
+
+/* Positions keep 16 bits per axis over the mesh bounds, normals 10 bits and texture coordinates half precision. */
+QuantizedMesh QuantizeMesh(const MeshVertex* vertices, size_t count);
+inline QuantizedMesh QuantizeMesh(const std::vector<MeshVertex>& vertices) { return QuantizeMesh(vertices.data(), vertices.size()); }
+
+/* CPU side inverse of QuantizeMesh, for picking and for measuring the error. */
+MeshVertex DequantizeVertex(const QuantizedMesh& mesh, const QuantizedVertex& vertex);
+
+/* Largest distance between an original and a quantized position, in model units. */
+float GetMaxPositionError(const MeshVertex* vertices, size_t count, const QuantizedMesh& mesh);
@@ -0,0 +1,97 @@
+#include "MipChain.h"
+
+#include <cstring>
+
+namespace {
+
+	/* Rounded average of columns [x0, x0 + columnCount) over the given rows, written to the 4 bytes at out. */
+	void AverageBlock(const unsigned char* const* rows, int rowCount, int x0, int columnCount, unsigned char* out)
+	{
+		int count = rowCount * columnCount;
+		for (int c = 0; c < 4; c++)
+		{
+			int sum = 0;
+			for (int r = 0; r < rowCount; r++)
+				for (int x = x0; x < x0 + columnCount; x++)
+					sum += rows[r][x * 4 + c];
+			out[c] = (unsigned char)((sum + count / 2) / count);
+		}
+	}
+
+	/* Averages 2x2 blocks of source. An odd last row or column has no partner, so it is folded into the
+	last output row or column, which then averages 3 source texels across instead of 2. */
+	void Downsample(const unsigned char* source, int width, int height, unsigned char* destination, int mipWidth, int mipHeight)
+	{
+		bool extraColumn = width > 1 && width % 2 == 1;
+		bool extraRow = height > 1 && height % 2 == 1;
+		int columnCount = width > 1 ? 2 : 1;
+		/* Output columns filtered from exactly columnCount source columns. */
+		int pairColumns = extraColumn ? mipWidth - 1 : mipWidth;
+
+		for (int y = 0; y < mipHeight; y++)
+		{
+			const unsigned char* rows[3];
+			int rowCount = height > 1 ? 2 : 1;
+			if (extraRow && y == mipHeight - 1)
+				rowCount = 3;
+			for (int r = 0; r < rowCount; r++)
+				rows[r] = source + (size_t)(2 * y + r) * width * 4;
+			unsigned char* out = destination + (size_t)y * mipWidth * 4;
+
+			if (rowCount == 2 && columnCount == 2)
+			{
+				/* Plain byte loop over whole pixels, simple enough for the compiler to vectorize. */
+				const unsigned char* row0 = rows[0];
+				const unsigned char* row1 = rows[1];
+				for (int x = 0; x < pairColumns; x++)
+				{
+					int x0 = 2 * x * 4;
+					int x1 = x0 + 4;
+					for (int c = 0; c < 4; c++)
+						out[x * 4 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+				}
+			}
+			else
+			{
+				for (int x = 0; x < pairColumns; x++)
+					AverageBlock(rows, rowCount, 2 * x, columnCount, out + x * 4);
+			}
+
+			if (extraColumn)
+				AverageBlock(rows, rowCount, 2 * (mipWidth - 1), 3, out + (mipWidth - 1) * 4);
+		}
+	}
+}
+
+int BuildMipChain(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& chain)
+{
+	size_t total = 0;
+	int levels = 0;
+	for (int w = width, h = height; ; w = w > 1 ? w / 2 : 1, h = h > 1 ? h / 2 : 1)
+	{
+		total += (size_t)w * h * 4;
+		levels++;
+		if (w == 1 && h == 1)
+			break;
+	}
+
+	chain.resize(total);
+	memcpy(chain.data(), rgba, (size_t)width * height * 4);
+
+	/* Each level is filtered from the one before it. */
+	unsigned char* source = chain.data();
+	for (int i = 1; i < levels; i++)
+	{
+		int mipWidth = width > 1 ? width / 2 : 1;
+		int mipHeight = height > 1 ? height / 2 : 1;
+		unsigned char* destination = source + (size_t)width * height * 4;
+
+		Downsample(source, width, height, destination, mipWidth, mipHeight);
+
+		source = destination;
+		width = mipWidth;
+		height = mipHeight;
+	}
+
+	return levels;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <vector>
+
+/* Builds the full mip chain of a width * height RGBA8 image with a 2x2 box filter, on the CPU so it can run on
+loader threads. An odd last row or column is filtered 3 texels wide so no source texel is dropped. chain receives
+every level packed one after the other, level 0 first, ready for Texture::SetMipData. Returns the number of levels. */
+int BuildMipChain(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& chain);
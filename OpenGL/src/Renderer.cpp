@@ -1,5 +1,16 @@
 #include "Renderer.h"
+#include "Texture.h"
+#include "GLState.h"
+#include "UniformBuffer.h"
+#include <algorithm>
 #include <iostream>
+#include <atomic>
+#include <cstring>
+
+/* Last call site seen by GLCall. The callback can fire late or on a driver thread, so this is only a hint. */
+static std::atomic<const char*> s_CallFunction(nullptr);
+static std::atomic<const char*> s_CallFile(nullptr);
+static std::atomic<int> s_CallLine(0);
 
 /* This function clears openGL error flags, but does not print them. */
 void GLClearError()
@@ -22,15 +33,442 @@ bool GLLogCall(const char* function, const char* file, int line)
     return true;
 }
 
+void GLSetCallSite(const char* function, const char* file, int line)
+{
+    s_CallFunction.store(function, std::memory_order_relaxed);
+    s_CallFile.store(file, std::memory_order_relaxed);
+    s_CallLine.store(line, std::memory_order_relaxed);
+}
+
+static void GLAPIENTRY GLDebugMessage(GLenum /*source*/, GLenum /*type*/, GLuint id, GLenum /*severity*/,
+    GLsizei /*length*/, const GLchar* message, const void* /*userParam*/)
+{
+    const char* function = s_CallFunction.load(std::memory_order_relaxed);
+    const char* file = s_CallFile.load(std::memory_order_relaxed);
+
+    std::cout << "[OpenGL Debug] (" << id << ") " << message << std::endl;
+    if (function)
+    {
+        std::cout << "    last call: " << function << " "
+            << file << " : "
+            << s_CallLine.load(std::memory_order_relaxed) << std::endl;
+    }
+}
+
+void GLInitDebugOutput()
+{
+#if GL_ERROR_CHECK == GL_ERROR_CHECK_CALLBACK
+    if (!GLEW_VERSION_4_3 && !GLEW_KHR_debug)
+    {
+        std::cout << "KHR_debug not supported, GL errors will not be reported" << std::endl;
+        return;
+    }
+
+    glEnable(GL_DEBUG_OUTPUT);
+    glDebugMessageCallback(GLDebugMessage, nullptr);
+    /* Notifications are mostly buffer placement chatter, only keep real diagnostics. */
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+#endif
+}
+
+Renderer::Renderer()
+    :m_IndirectBuffer(0), m_DrawDataBuffer(0)
+{
+}
+
+Renderer::~Renderer()
+{
+    if (m_IndirectBuffer)
+    {
+        GLState::ForgetBuffer(m_IndirectBuffer);
+        GLCall(glDeleteBuffers(1, &m_IndirectBuffer));
+    }
+    if (m_DrawDataBuffer)
+    {
+        GLState::ForgetBuffer(m_DrawDataBuffer);
+        GLCall(glDeleteBuffers(1, &m_DrawDataBuffer));
+    }
+}
+
 void Renderer::Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader) const
 {
+    /* Shaders still compiling in the background are skipped instead of stalling the frame. */
+    if (!shader.IsReady())
+        return;
+
+    shader.Bind();
+    va.Bind();
+    ib.Bind();
+    GLCall(glDrawElements(GL_TRIANGLES, ib.GetCount(), ib.GetType(), nullptr));
+}
+
+void Renderer::Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int count) const
+{
+    if (!shader.IsReady())
+        return;
+
+    shader.Bind();
+    va.Bind();
+    ib.Bind();
+    GLCall(glDrawElements(GL_TRIANGLES, count, ib.GetType(), nullptr));
+}
+
+void Renderer::Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int count, int baseVertex) const
+{
+    if (!shader.IsReady())
+        return;
+
+    shader.Bind();
+    va.Bind();
+    ib.Bind();
+    GLCall(glDrawElementsBaseVertex(GL_TRIANGLES, count, ib.GetType(), nullptr, baseVertex));
+}
+
+void Renderer::DrawRange(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int firstIndex, unsigned int count, int baseVertex) const
+{
+    if (!shader.IsReady())
+        return;
+
+    shader.Bind();
+    va.Bind();
+    ib.Bind();
+    GLCall(glDrawElementsBaseVertex(GL_TRIANGLES, count, ib.GetType(),
+        (void*)((uintptr_t)firstIndex * ib.GetIndexSize()), baseVertex));
+}
+
+void Renderer::DrawInstanced(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int instanceCount) const
+{
+    if (!shader.IsReady())
+        return;
+
     shader.Bind();
     va.Bind();
     ib.Bind();
-    GLCall(glDrawElements(GL_TRIANGLES, ib.GetCount(), GL_UNSIGNED_INT, nullptr));
+    GLCall(glDrawElementsInstanced(GL_TRIANGLES, ib.GetCount(), ib.GetType(), nullptr, instanceCount));
+}
+
+void Renderer::UploadIndirect(const DrawElementsIndirectCommand* commands, unsigned int count)
+{
+    if (!m_IndirectBuffer)
+        m_IndirectBuffer = CreateBuffer(GL_DRAW_INDIRECT_BUFFER);
+    /* Orphaned every time, the previous contents may still be in flight. */
+    SetBufferData(m_IndirectBuffer, GL_DRAW_INDIRECT_BUFFER, count * (unsigned int)sizeof(DrawElementsIndirectCommand), commands, GL_STREAM_DRAW);
+    /* The draw reads its commands from whatever is bound here, direct state access left the binding alone. */
+    GLState::BindBuffer(GL_DRAW_INDIRECT_BUFFER, m_IndirectBuffer);
+}
+
+void Renderer::MultiDrawIndirect(const VertexArray& va, const IndexBuffer& ib, const Shader& shader,
+    const DrawElementsIndirectCommand* commands, unsigned int count)
+{
+    if (!shader.IsReady() || count == 0)
+        return;
+
+    shader.Bind();
+    va.Bind();
+    ib.Bind();
+    UploadIndirect(commands, count);
+    GLCall(glMultiDrawElementsIndirect(GL_TRIANGLES, ib.GetType(), nullptr, count, 0));
 }
 
 void Renderer::Clear() const
 {
     GLCall(glClear(GL_COLOR_BUFFER_BIT));
 }
+
+uint64_t Renderer::MakeSortKey(const Shader& shader, const Texture* texture, const VertexArray& va, float depth)
+{
+    uint64_t program = shader.GetRendererID() & 0xffff;
+    uint64_t tex = texture ? texture->GetRendererID() & 0xffff : 0;
+    uint64_t vao = va.GetRendererID() & 0xffff;
+
+    if (depth < 0.0f) depth = 0.0f;
+    if (depth > 1.0f) depth = 1.0f;
+    uint64_t z = (uint64_t)(depth * 65535.0f);
+
+    return (program << 48) | (tex << 32) | (vao << 16) | z;
+}
+
+void Renderer::Submit(const VertexArray& va, const IndexBuffer& ib, Shader& shader, const glm::mat4& model,
+    const Texture* texture, float depth)
+{
+    RenderCommand command;
+    command.VAO = &va;
+    command.IBO = &ib;
+    command.Program = &shader;
+    command.Tex = texture;
+    command.Model = model;
+    command.FirstIndex = 0;
+    command.IndexCount = ib.GetCount();
+    command.BaseVertex = 0;
+    Submit(command, depth);
+}
+
+void Renderer::Submit(const RenderCommand& command, float depth)
+{
+    m_Queue.push_back(command);
+    m_Queue.back().SortKey = MakeSortKey(*command.Program, command.Tex, *command.VAO, depth);
+}
+
+/* LSD radix sort on the keys, 8 bits per pass. Only m_Order is permuted, the commands stay where they are.
+Passes where every key has the same byte are skipped, which is the common case for the high shader bits. */
+void Renderer::SortQueue()
+{
+    unsigned int count = (unsigned int)m_Queue.size();
+    m_Keys.resize(count);
+    m_KeysTemp.resize(count);
+    m_Order.resize(count);
+    m_OrderTemp.resize(count);
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        m_Keys[i] = m_Queue[i].SortKey;
+        m_Order[i] = i;
+    }
+
+    for (unsigned int shift = 0; shift < 64; shift += 8)
+    {
+        unsigned int histogram[256] = {};
+        for (unsigned int i = 0; i < count; i++)
+            histogram[(m_Keys[i] >> shift) & 0xff]++;
+
+        if (histogram[(m_Keys[0] >> shift) & 0xff] == count)
+            continue;
+
+        unsigned int offset = 0;
+        for (unsigned int b = 0; b < 256; b++)
+        {
+            unsigned int n = histogram[b];
+            histogram[b] = offset;
+            offset += n;
+        }
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            unsigned int dst = histogram[(m_Keys[i] >> shift) & 0xff]++;
+            m_KeysTemp[dst] = m_Keys[i];
+            m_OrderTemp[dst] = m_Order[i];
+        }
+
+        m_Keys.swap(m_KeysTemp);
+        m_Order.swap(m_OrderTemp);
+    }
+}
+
+static constexpr UniformName s_ModelName("u_Model");
+
+/* Matrices only have to match when the shader takes them through the u_Model uniform, not from DrawData. */
+static bool CanMerge(const RenderCommand& a, const RenderCommand& b, bool perDrawModels)
+{
+    return a.Program == b.Program && a.Tex == b.Tex && a.VAO == b.VAO && a.IBO == b.IBO
+        && (perDrawModels || memcmp(&a.Model, &b.Model, sizeof(glm::mat4)) == 0);
+}
+
+static bool SameMesh(const RenderCommand& a, const RenderCommand& b)
+{
+    return a.FirstIndex == b.FirstIndex && a.IndexCount == b.IndexCount && a.BaseVertex == b.BaseVertex;
+}
+
+void Renderer::UploadDrawData(unsigned int count)
+{
+    if (!m_DrawDataBuffer)
+        m_DrawDataBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER);
+    /* Orphaned every time, the previous contents may still be read by earlier draws. */
+    SetBufferData(m_DrawDataBuffer, GL_SHADER_STORAGE_BUFFER, count * (unsigned int)sizeof(glm::mat4), m_DrawData.data(), GL_STREAM_DRAW);
+    GLState::BindBufferRange(GL_SHADER_STORAGE_BUFFER, StorageBinding::DrawData, m_DrawDataBuffer, 0, count * (unsigned int)sizeof(glm::mat4));
+}
+
+void Renderer::DrawInstancedRun(unsigned int begin, unsigned int end)
+{
+    /* Grouping by mesh gives fewer draws but reorders different meshes, which only blending can see.
+    Stable, so commands drawing the same mesh keep their depth order. With blending only neighbours are grouped. */
+    if (!GLState::IsBlendEnabled())
+    {
+        std::stable_sort(m_Order.begin() + begin, m_Order.begin() + end, [this](unsigned int a, unsigned int b)
+        {
+            const RenderCommand& x = m_Queue[a];
+            const RenderCommand& y = m_Queue[b];
+            if (x.FirstIndex != y.FirstIndex) return x.FirstIndex < y.FirstIndex;
+            if (x.BaseVertex != y.BaseVertex) return x.BaseVertex < y.BaseVertex;
+            return x.IndexCount < y.IndexCount;
+        });
+    }
+
+    m_DrawData.resize(end - begin);
+    for (unsigned int j = begin; j < end; j++)
+        m_DrawData[j - begin] = m_Queue[m_Order[j]].Model;
+    UploadDrawData(end - begin);
+
+    for (unsigned int j = begin; j < end;)
+    {
+        const RenderCommand& command = m_Queue[m_Order[j]];
+        unsigned int last = j + 1;
+        while (last < end && SameMesh(command, m_Queue[m_Order[last]]))
+            last++;
+
+        /* Base instance picks the first matrix, shaders index DrawData with gl_BaseInstance + gl_InstanceID. */
+        GLCall(glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.IndexCount, command.IBO->GetType(),
+            (void*)((uintptr_t)command.FirstIndex * command.IBO->GetIndexSize()), last - j, command.BaseVertex, j - begin));
+        m_Stats.DrawCalls++;
+        j = last;
+    }
+}
+
+void Renderer::Flush()
+{
+    if (m_Queue.empty())
+        return;
+
+    SortQueue();
+
+    const Shader* currentProgram = nullptr;
+    const Texture* currentTexture = nullptr;
+    unsigned int count = (unsigned int)m_Queue.size();
+    /* Shaders see the base instance through gl_BaseInstance, core in 4.6. */
+    bool drawDataSupported = GLEW_VERSION_4_6 || GLEW_ARB_shader_draw_parameters;
+
+    for (unsigned int i = 0; i < count;)
+    {
+        RenderCommand& command = m_Queue[m_Order[i]];
+
+        /* Shaders with a DrawData block read their matrices from it, so differing transforms can share a draw.
+        Runs of a shader that isn't ready are skipped whole, their matrices don't matter. */
+        bool ready = command.Program->IsReady();
+        bool perDrawModels = ready && drawDataSupported && command.Program->ReadsDrawData();
+
+        /* Collect the run of commands that can share one draw call. */
+        unsigned int end = i + 1;
+        while (end < count && CanMerge(command, m_Queue[m_Order[end]], !ready || perDrawModels))
+            end++;
+
+        if (!ready)
+        {
+            i = end;
+            continue;
+        }
+
+        if (command.Program != currentProgram)
+        {
+            command.Program->Bind();
+            currentProgram = command.Program;
+            m_Stats.ProgramChanges++;
+        }
+        if (command.Tex && command.Tex != currentTexture)
+        {
+            command.Tex->Bind();
+            currentTexture = command.Tex;
+            m_Stats.TextureChanges++;
+        }
+        command.VAO->Bind();
+        command.IBO->Bind();
+
+        if (perDrawModels)
+        {
+            DrawInstancedRun(i, end);
+            i = end;
+            continue;
+        }
+
+        command.Program->SetUniformMat4f(s_ModelName, command.Model);
+
+        if (end - i == 1)
+        {
+            GLCall(glDrawElementsBaseVertex(GL_TRIANGLES, command.IndexCount, command.IBO->GetType(),
+                (void*)((uintptr_t)command.FirstIndex * command.IBO->GetIndexSize()), command.BaseVertex));
+        }
+        else
+        {
+            m_MultiCounts.clear();
+            m_MultiOffsets.clear();
+            m_MultiBaseVertices.clear();
+            for (unsigned int j = i; j < end; j++)
+            {
+                const RenderCommand& merged = m_Queue[m_Order[j]];
+                m_MultiCounts.push_back(merged.IndexCount);
+                m_MultiOffsets.push_back((const void*)((uintptr_t)merged.FirstIndex * merged.IBO->GetIndexSize()));
+                m_MultiBaseVertices.push_back(merged.BaseVertex);
+            }
+            GLCall(glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_MultiCounts.data(), command.IBO->GetType(),
+                (void**)m_MultiOffsets.data(), (GLsizei)m_MultiCounts.size(), m_MultiBaseVertices.data()));
+        }
+
+        m_Stats.DrawCalls++;
+        i = end;
+    }
+
+    m_Stats.Commands += count;
+    m_Queue.clear();
+}
+
+static bool CanMergeIndirect(const RenderCommand& a, const RenderCommand& b)
+{
+    return a.Program == b.Program && a.Tex == b.Tex && a.VAO == b.VAO && a.IBO == b.IBO;
+}
+
+void Renderer::FlushIndirect()
+{
+    if (m_Queue.empty())
+        return;
+
+    SortQueue();
+
+    /* Everything is uploaded at once, each run then draws its own slice of the indirect buffer. */
+    unsigned int count = (unsigned int)m_Queue.size();
+    m_IndirectCommands.resize(count);
+    m_DrawData.resize(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const RenderCommand& command = m_Queue[m_Order[i]];
+        DrawElementsIndirectCommand& indirect = m_IndirectCommands[i];
+        indirect.Count = command.IndexCount;
+        indirect.InstanceCount = 1;
+        indirect.FirstIndex = command.FirstIndex;
+        indirect.BaseVertex = command.BaseVertex;
+        indirect.BaseInstance = i;
+        m_DrawData[i] = command.Model;
+    }
+
+    UploadIndirect(m_IndirectCommands.data(), count);
+    UploadDrawData(count);
+
+    const Shader* currentProgram = nullptr;
+    const Texture* currentTexture = nullptr;
+
+    for (unsigned int i = 0; i < count;)
+    {
+        RenderCommand& command = m_Queue[m_Order[i]];
+
+        unsigned int end = i + 1;
+        while (end < count && CanMergeIndirect(command, m_Queue[m_Order[end]]))
+            end++;
+
+        if (!command.Program->IsReady())
+        {
+            i = end;
+            continue;
+        }
+
+        if (command.Program != currentProgram)
+        {
+            command.Program->Bind();
+            currentProgram = command.Program;
+            m_Stats.ProgramChanges++;
+        }
+        if (command.Tex && command.Tex != currentTexture)
+        {
+            command.Tex->Bind();
+            currentTexture = command.Tex;
+            m_Stats.TextureChanges++;
+        }
+        command.VAO->Bind();
+        command.IBO->Bind();
+
+        GLCall(glMultiDrawElementsIndirect(GL_TRIANGLES, command.IBO->GetType(),
+            (const void*)(i * sizeof(DrawElementsIndirectCommand)), end - i, 0));
+
+        m_Stats.DrawCalls++;
+        i = end;
+    }
+
+    m_Stats.Commands += count;
+    m_Queue.clear();
+}
@@ -1,14 +1,44 @@
 #pragma once
 
 #include<GL/glew.h>
+#include <cstdint>
+#include <vector>
 #include "VertexArray.h"
 #include "IndexBuffer.h"
 #include "Shader.h"
 
+#include "glm/glm.hpp"
+
+class Texture;
+
 #define ASSERT(x) if (!(x)) __debugbreak();
-#define GLCall(x) GLClearError;\
-    x;\
-    ASSERT(GLLogCall(#x, __FILE__, __LINE__))
+
+/* How GLCall checks for errors. Override by adding GL_ERROR_CHECK=<mode> to the preprocessor definitions.
+NONE:     GLCall compiles down to the bare call, no glGetError round trips.
+SYNC:     errors are cleared before and checked after every call, breaks on the failing call.
+CALLBACK: the driver reports errors through glDebugMessageCallback, GLCall only records the call site. */
+#define GL_ERROR_CHECK_NONE     0
+#define GL_ERROR_CHECK_SYNC     1
+#define GL_ERROR_CHECK_CALLBACK 2
+
+#ifndef GL_ERROR_CHECK
+    #ifdef _DEBUG
+        #define GL_ERROR_CHECK GL_ERROR_CHECK_SYNC
+    #else
+        #define GL_ERROR_CHECK GL_ERROR_CHECK_NONE
+    #endif
+#endif
+
+#if GL_ERROR_CHECK == GL_ERROR_CHECK_SYNC
+    #define GLCall(x) GLClearError();\
+        x;\
+        ASSERT(GLLogCall(#x, __FILE__, __LINE__))
+#elif GL_ERROR_CHECK == GL_ERROR_CHECK_CALLBACK
+    #define GLCall(x) GLSetCallSite(#x, __FILE__, __LINE__);\
+        x
+#else
+    #define GLCall(x) x
+#endif
 
 /* This function clears openGL error flags, but does not print them. */
 void GLClearError();
@@ -16,12 +46,118 @@ void GLClearError();
 /* This function clears the openGL error flags and prints them as it goes. */
 bool GLLogCall(const char* function, const char* file, int line);
 
+/* Remembers the last GLCall so debug callback messages can point at it. */
+void GLSetCallSite(const char* function, const char* file, int line);
+
+/* Installs the debug message callback when GL_ERROR_CHECK is CALLBACK, call once after glewInit. */
+void GLInitDebugOutput();
+
+
+/* One queued draw. Commands sharing shader, texture, vertex array and index buffer are merged by Flush: into instanced draws
+whatever the matrices if the shader reads them from the DrawData storage buffer (see Indirect.shader) and the context has
+shader draw parameters, otherwise into one multi-draw if the matrices are equal.
+View and projection come from the Camera uniform block, so they are not part of the command. */
+struct RenderCommand
+{
+    uint64_t SortKey;
+    const VertexArray* VAO;
+    const IndexBuffer* IBO;
+    Shader* Program;
+    const Texture* Tex;
+    glm::mat4 Model;
+    /* Range of indices in IBO to draw. */
+    unsigned int FirstIndex;
+    unsigned int IndexCount;
+    /* Added to every index, lets meshes share one vertex buffer. */
+    int BaseVertex = 0;
+};
+
+/* Layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER. */
+struct DrawElementsIndirectCommand
+{
+    unsigned int Count;
+    unsigned int InstanceCount;
+    unsigned int FirstIndex;
+    int BaseVertex;
+    /* Also offsets per-instance attributes, FlushIndirect uses it as the index into DrawData. */
+    unsigned int BaseInstance;
+};
 
 class Renderer
 {
+public:
+    struct QueueStats
+    {
+        unsigned int Commands = 0;
+        unsigned int DrawCalls = 0;
+        unsigned int ProgramChanges = 0;
+        unsigned int TextureChanges = 0;
+    };
+
 private:
+    std::vector<RenderCommand> m_Queue;
+    /* Scratch buffers for the radix sort, kept around to avoid reallocating every frame. */
+    std::vector<uint64_t> m_Keys, m_KeysTemp;
+    std::vector<unsigned int> m_Order, m_OrderTemp;
+    std::vector<GLsizei> m_MultiCounts;
+    std::vector<const void*> m_MultiOffsets;
+    std::vector<GLint> m_MultiBaseVertices;
+    /* Indirect path, the buffers are created on first use and orphaned on every upload. */
+    std::vector<DrawElementsIndirectCommand> m_IndirectCommands;
+    std::vector<glm::mat4> m_DrawData;
+    unsigned int m_IndirectBuffer;
+    unsigned int m_DrawDataBuffer;
+    QueueStats m_Stats;
+
+    void SortQueue();
+    void UploadIndirect(const DrawElementsIndirectCommand* commands, unsigned int count);
+    /* Uploads the first count matrices of m_DrawData and binds them to StorageBinding::DrawData. */
+    void UploadDrawData(unsigned int count);
+    /* Draws the sorted commands [begin, end), which share all state, with their matrices in DrawData.
+    Commands drawing the same index range are grouped into one instanced draw. */
+    void DrawInstancedRun(unsigned int begin, unsigned int end);
+
 public:
+    Renderer();
+    ~Renderer();
+
+    /* Owns the GL buffers of the indirect path. */
+    Renderer(const Renderer&) = delete;
+    Renderer& operator=(const Renderer&) = delete;
+
+    /* Builds the 64 bit sort key: shader | texture | vertex array | depth, 16 bits each from the top.
+    Depth is expected in [0, 1] and only orders commands that share all other state. */
+    static uint64_t MakeSortKey(const Shader& shader, const Texture* texture, const VertexArray& va, float depth);
+
+    /* Queues a draw of all of ib, model is uploaded to the u_Model uniform when it is executed.
+    The queue keeps pointers, so the resources must not be moved or destroyed before Flush. */
+    void Submit(const VertexArray& va, const IndexBuffer& ib, Shader& shader, const glm::mat4& model,
+        const Texture* texture = nullptr, float depth = 0.0f);
+    /* Queues a fully described command, SortKey is filled in here. */
+    void Submit(const RenderCommand& command, float depth = 0.0f);
+    /* Sorts the queue to minimize state changes, draws it and empties it. Instanced merging needs GL 4.3. */
+    void Flush();
+    /* Like Flush, but every run of commands sharing shader, texture, vertex array and index buffer becomes one
+    glMultiDrawElementsIndirect whatever their model matrices. The matrices go to the DrawData storage buffer
+    in queue order, shaders read them with u_Models[gl_BaseInstance], see Indirect.shader.
+    Needs GL 4.3 and ARB_shader_draw_parameters, which is core in 4.6. */
+    void FlushIndirect();
+
+    inline const QueueStats& GetQueueStats() const { return m_Stats; }
+    inline void ResetQueueStats() { m_Stats = QueueStats(); }
+
     /* Vertex Buffer is bound in Vertex Array. */
     void Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader) const;
+    /* Draws only the first count indices of ib, used by batches that are partially filled. */
+    void Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int count) const;
+    /* Adds baseVertex to every index, used to draw from an offset into a shared or streaming vertex buffer. */
+    void Draw(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int count, int baseVertex) const;
+    /* Draws count indices starting at firstIndex, used for meshes suballocated from shared buffers. */
+    void DrawRange(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int firstIndex, unsigned int count, int baseVertex) const;
+    /* Draws ib instanceCount times in one call, per-instance data comes from divisor attributes in va. */
+    void DrawInstanced(const VertexArray& va, const IndexBuffer& ib, const Shader& shader, unsigned int instanceCount) const;
+    /* Uploads count commands and issues them as a single glMultiDrawElementsIndirect, any per-draw data is up to the caller. */
+    void MultiDrawIndirect(const VertexArray& va, const IndexBuffer& ib, const Shader& shader,
+        const DrawElementsIndirectCommand* commands, unsigned int count);
     void Clear() const;
 };
\ No newline at end of file
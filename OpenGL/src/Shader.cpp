@@ -1,9 +1,103 @@
 #include "Shader.h"
 #include "Renderer.h"
+#include "GLState.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+static ShaderCacheStats s_CacheStats;
+static UniformStats s_UniformStats;
+
+/* Header of a cached program binary, the driver's blob follows it. */
+struct ProgramBinaryHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t Key;
+    uint32_t Format;
+    uint32_t Length;
+    double CompileMilliseconds;
+};
+
+static const uint32_t ProgramBinaryMagic = 0x43425350; // "PSBC"
+static const uint32_t ProgramBinaryVersion = 1;
+
+/* FNV-1a, continued from hash so several strings can be chained into one key. */
+static uint64_t HashString(uint64_t hash, const char* str, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 1099511628211ull;
+    }
+    /* Separator so "ab" + "c" and "a" + "bc" differ. */
+    hash ^= 0xff;
+    hash *= 1099511628211ull;
+    return hash;
+}
+
+static bool ProgramBinariesSupported()
+{
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+        return false;
+
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+/* glProgramUniform writes to a program by name, core since 4.1. */
+static bool ProgramUniformsSupported()
+{
+    return GLEW_VERSION_4_1 || GLEW_ARB_separate_shader_objects;
+}
+
+static bool ParallelCompileSupported()
+{
+    return GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile;
+}
+
+/* Bytes of one element of a uniform, 0 for types the shadow copy doesn't track. */
+static unsigned int GetUniformTypeSize(unsigned int type)
+{
+    switch (type)
+    {
+        case GL_FLOAT:          return 4;
+        case GL_FLOAT_VEC2:     return 8;
+        case GL_FLOAT_VEC3:     return 12;
+        case GL_FLOAT_VEC4:     return 16;
+        case GL_INT:            return 4;
+        case GL_INT_VEC2:       return 8;
+        case GL_INT_VEC3:       return 12;
+        case GL_INT_VEC4:       return 16;
+        case GL_UNSIGNED_INT:   return 4;
+        case GL_BOOL:           return 4;
+        case GL_FLOAT_MAT2:     return 16;
+        case GL_FLOAT_MAT3:     return 36;
+        case GL_FLOAT_MAT4:     return 64;
+        case GL_SAMPLER_1D:
+        case GL_SAMPLER_2D:
+        case GL_SAMPLER_3D:
+        case GL_SAMPLER_CUBE:
+        case GL_SAMPLER_2D_ARRAY:
+        case GL_SAMPLER_2D_SHADOW:
+            return 4;
+    }
+    return 0;
+}
+
+static double MillisecondsSince(std::chrono::high_resolution_clock::time_point start)
+{
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
 
 
 Shader::Shader(const std::string& filepath)
-	:m_Filepath(filepath), m_RenderID(0)
+	:m_Filepath(filepath), m_RenderID(0), m_HashCollision(false), m_HasDrawData(false), m_Status(Status::Compiling),
+	m_VertexID(0), m_FragmentID(0), m_CacheKey(0), m_CompileMilliseconds(-1.0)
 {
 
     ShaderProgramSource source = ParseShader(filepath);
@@ -13,7 +107,65 @@ Shader::Shader(const std::string& filepath)
 
 Shader::~Shader()
 {
+    Release();
+}
+
+Shader::Shader(Shader&& other) noexcept
+    :m_Filepath(std::move(other.m_Filepath)), m_RenderID(other.m_RenderID),
+    m_Uniforms(std::move(other.m_Uniforms)), m_UniformBlocks(std::move(other.m_UniformBlocks)),
+    m_HashCollision(other.m_HashCollision), m_HasDrawData(other.m_HasDrawData), m_MissingUniforms(std::move(other.m_MissingUniforms)), m_UniformValues(std::move(other.m_UniformValues)),
+    m_Status(other.m_Status), m_VertexID(other.m_VertexID), m_FragmentID(other.m_FragmentID),
+    m_CacheKey(other.m_CacheKey), m_CompileStart(other.m_CompileStart), m_CompileMilliseconds(other.m_CompileMilliseconds)
+{
+    other.m_RenderID = 0;
+    other.m_VertexID = 0;
+    other.m_FragmentID = 0;
+    other.m_Status = Status::Failed;
+}
+
+Shader& Shader::operator=(Shader&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        m_Filepath = std::move(other.m_Filepath);
+        m_RenderID = other.m_RenderID;
+        m_Uniforms = std::move(other.m_Uniforms);
+        m_UniformBlocks = std::move(other.m_UniformBlocks);
+        m_HashCollision = other.m_HashCollision;
+        m_HasDrawData = other.m_HasDrawData;
+        m_MissingUniforms = std::move(other.m_MissingUniforms);
+        m_UniformValues = std::move(other.m_UniformValues);
+        m_Status = other.m_Status;
+        m_VertexID = other.m_VertexID;
+        m_FragmentID = other.m_FragmentID;
+        m_CacheKey = other.m_CacheKey;
+        m_CompileStart = other.m_CompileStart;
+        m_CompileMilliseconds = other.m_CompileMilliseconds;
+
+        other.m_RenderID = 0;
+        other.m_VertexID = 0;
+        other.m_FragmentID = 0;
+        other.m_Status = Status::Failed;
+    }
+    return *this;
+}
+
+void Shader::Release()
+{
+    /* Still compiling, the shader objects were never cleaned up by Resolve. */
+    if (m_VertexID)
+        glDeleteShader(m_VertexID);
+    if (m_FragmentID)
+        glDeleteShader(m_FragmentID);
+    m_VertexID = m_FragmentID = 0;
+
+    if (m_RenderID == 0)
+        return;
+
+    GLState::ForgetProgram(m_RenderID);
     GLCall(glDeleteProgram(m_RenderID));
+    m_RenderID = 0;
 }
 
 ShaderProgramSource Shader::ParseShader(const std::string& filepath)
@@ -54,6 +206,7 @@ ShaderProgramSource Shader::ParseShader(const std::string& filepath)
     return { ss[0].str(), ss[1].str() };
 }
 
+/* Only issues the compile, querying the status here would wait for it. */
 unsigned int Shader::CompilerShader(unsigned int type, const std::string& source)
 {
     unsigned int id = glCreateShader(type);
@@ -61,6 +214,11 @@ unsigned int Shader::CompilerShader(unsigned int type, const std::string& source
     glShaderSource(id, 1, &src, nullptr);
     glCompileShader(id);
 
+    return id;
+}
+
+bool Shader::CheckShader(unsigned int id) const
+{
     /* Error handling. */
     int result;
     glGetShaderiv(id, GL_COMPILE_STATUS, &result);
@@ -70,79 +228,479 @@ unsigned int Shader::CompilerShader(unsigned int type, const std::string& source
         glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
         char* message = (char*)alloca(length * sizeof(char));
         glGetShaderInfoLog(id, length, &length, message);
-        std::cout << "Failed to Compile shader " << std::endl;
+        std::cout << "Failed to Compile shader " << m_Filepath << std::endl;
         std::cout << message << std::endl;
+        return false;
+    }
+
+    return true;
+}
 
-        /* Delete failed shader and return 0. */
-        glDeleteShader(id);
+uint64_t Shader::MakeCacheKey(const std::string& vertexShader, const std::string& fragmentShader) const
+{
+    /* A binary is only valid for the exact driver that produced it. */
+    const char* vendor = (const char*)glGetString(GL_VENDOR);
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    const char* version = (const char*)glGetString(GL_VERSION);
+
+    uint64_t hash = 14695981039346656037ull;
+    hash = HashString(hash, vertexShader.c_str(), vertexShader.size());
+    hash = HashString(hash, fragmentShader.c_str(), fragmentShader.size());
+    hash = HashString(hash, vendor, strlen(vendor));
+    hash = HashString(hash, renderer, strlen(renderer));
+    hash = HashString(hash, version, strlen(version));
+    return hash;
+}
+
+/* Returns a linked program from the cache, or 0 if there is no usable binary. */
+unsigned int Shader::LoadProgramBinary(uint64_t key)
+{
+    if (!ProgramBinariesSupported())
+        return 0;
+
+    std::ifstream stream(m_Filepath + ".bin", std::ios::binary | std::ios::ate);
+    if (!stream)
+        return 0;
+    std::streamoff fileSize = stream.tellg();
+    stream.seekg(0);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    ProgramBinaryHeader header;
+    if (!stream.read((char*)&header, sizeof(header)) || header.Magic != ProgramBinaryMagic
+        || header.Version != ProgramBinaryVersion || header.Key != key)
+        return 0;
+
+    /* The length comes from disk, a truncated or corrupt file must not size the allocation. */
+    if (header.Length == 0 || header.Length > fileSize - (std::streamoff)sizeof(header))
+        return 0;
+
+    std::vector<char> binary(header.Length);
+    if (!stream.read(binary.data(), binary.size()))
+        return 0;
+
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, header.Format, binary.data(), header.Length);
+
+    /* Drivers may refuse binaries after an update even with a matching version string. */
+    int linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked == GL_FALSE)
+    {
+        glDeleteProgram(program);
+        s_CacheStats.Rejected++;
         return 0;
     }
 
-    return id;
+    double milliseconds = MillisecondsSince(start);
+    s_CacheStats.Hits++;
+    s_CacheStats.LoadMilliseconds += milliseconds;
+    s_CacheStats.SavedMilliseconds += header.CompileMilliseconds - milliseconds;
+    return program;
 }
 
-/* Provide openGl with a shader source code and text, want openGl to complie and link, then give unique to bind, link the buffer. */
+void Shader::SaveProgramBinary(unsigned int program, uint64_t key, double compileMilliseconds) const
+{
+    int length = 0;
+    GLCall(glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length));
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    GLCall(glGetProgramBinary(program, length, &length, &format, binary.data()));
+
+    ProgramBinaryHeader header = { ProgramBinaryMagic, ProgramBinaryVersion, key, format, (uint32_t)length, compileMilliseconds };
+
+    std::ofstream stream(m_Filepath + ".bin", std::ios::binary | std::ios::trunc);
+    stream.write((const char*)&header, sizeof(header));
+    stream.write(binary.data(), length);
+}
+
+/* Provide openGl with a shader source code and text, want openGl to complie and link, then give unique to bind, link the buffer.
+Nothing here waits on the driver, results are collected by Resolve. */
 unsigned int Shader::Createshader(const std::string& vertexShader, const std::string& fragmentShader)
 {
+    m_CacheKey = MakeCacheKey(vertexShader, fragmentShader);
+    unsigned int cached = LoadProgramBinary(m_CacheKey);
+    if (cached)
+    {
+        m_Status = Status::Ready;
+        m_RenderID = cached;
+        Reflect();
+        return cached;
+    }
+
+    m_CompileStart = std::chrono::high_resolution_clock::now();
+
     unsigned int program = glCreateProgram();
 
     /* Think of these as files that need to be linked. */
-    unsigned int vs = CompilerShader(GL_VERTEX_SHADER, vertexShader);
-    unsigned int fs = CompilerShader(GL_FRAGMENT_SHADER, fragmentShader);
+    m_VertexID = CompilerShader(GL_VERTEX_SHADER, vertexShader);
+    m_FragmentID = CompilerShader(GL_FRAGMENT_SHADER, fragmentShader);
 
     /* Attach shaders to program. */
-    GLCall(glAttachShader(program, vs));
-    GLCall(glAttachShader(program, fs));
+    GLCall(glAttachShader(program, m_VertexID));
+    GLCall(glAttachShader(program, m_FragmentID));
+
+    if (ProgramBinariesSupported())
+    {
+        GLCall(glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+    }
 
     GLCall(glLinkProgram(program));
-    GLCall(glValidateProgram(program));
+
+    return program;
+}
+
+void Shader::Resolve() const
+{
+    if (m_Status != Status::Compiling)
+        return;
+
+    bool compiled = CheckShader(m_VertexID);
+    compiled = CheckShader(m_FragmentID) && compiled;
+
+    int linked;
+    GLCall(glGetProgramiv(m_RenderID, GL_LINK_STATUS, &linked));
+    /* Resolving later than the poll that saw the link finish must not count the wait in between. */
+    double milliseconds = m_CompileMilliseconds >= 0.0 ? m_CompileMilliseconds : MillisecondsSince(m_CompileStart);
+    s_CacheStats.Misses++;
+    s_CacheStats.CompileMilliseconds += milliseconds;
 
     /* Get rid of shaders now that they are part of the program. */
-    GLCall(glDeleteShader(vs));
-    GLCall(glDeleteShader(fs));
+    GLCall(glDeleteShader(m_VertexID));
+    GLCall(glDeleteShader(m_FragmentID));
+    m_VertexID = m_FragmentID = 0;
 
-    return program;
+    if (!compiled || linked == GL_FALSE)
+    {
+        int length;
+        glGetProgramiv(m_RenderID, GL_INFO_LOG_LENGTH, &length);
+        std::vector<char> message(length + 1);
+        glGetProgramInfoLog(m_RenderID, length, &length, message.data());
+        std::cout << "Failed to link program " << m_Filepath << std::endl;
+        std::cout << message.data() << std::endl;
+
+        m_Status = Status::Failed;
+        return;
+    }
+
+    GLCall(glValidateProgram(m_RenderID));
+    if (ProgramBinariesSupported())
+        SaveProgramBinary(m_RenderID, m_CacheKey, milliseconds);
+
+    m_Status = Status::Ready;
+    Reflect();
 }
 
+bool Shader::IsReady() const
+{
+    if (m_Status == Status::Compiling && ParallelCompileSupported())
+    {
+        int done = GL_FALSE;
+        GLCall(glGetProgramiv(m_RenderID, GL_COMPLETION_STATUS_KHR, &done));
+        if (done == GL_FALSE)
+            return false;
+        m_CompileMilliseconds = MillisecondsSince(m_CompileStart);
+    }
+
+    Resolve();
+    return m_Status == Status::Ready;
+}
+
+bool Shader::HasFailed() const
+{
+    return m_Status == Status::Failed;
+}
+
+void Shader::WaitUntilReady() const
+{
+    Resolve();
+}
+
+void Shader::EnableParallelCompile()
+{
+    if (GLEW_KHR_parallel_shader_compile)
+    {
+        GLCall(glMaxShaderCompilerThreadsKHR(0xffffffff));
+    }
+    else if (GLEW_ARB_parallel_shader_compile)
+    {
+        GLCall(glMaxShaderCompilerThreadsARB(0xffffffff));
+    }
+}
+
+const ShaderCacheStats& Shader::GetCacheStats()
+{
+    return s_CacheStats;
+}
+
+const UniformStats& Shader::GetUniformStats()
+{
+    return s_UniformStats;
+}
+
+void Shader::ResetUniformStats()
+{
+    s_UniformStats = UniformStats();
+}
 
 void Shader::Bind() const
 {
-    GLCall(glUseProgram(m_RenderID));
+    GLState::UseProgram(m_RenderID);
 }
 
 void Shader::Unbind() const
 {
-    GLCall(glUseProgram(0));
+    GLState::UseProgram(0);
+}
+
+bool Shader::UpdateUniformValue(int handle, const void* data, unsigned int size)
+{
+    UniformInfo& info = m_Uniforms[handle];
+    /* Untracked types and writes past the shadow copy always go to the driver. */
+    if (size > info.ShadowSize)
+    {
+        s_UniformStats.Uploaded++;
+        return true;
+    }
+
+    unsigned char* shadow = &m_UniformValues[info.ShadowOffset];
+    if (info.ShadowValid && memcmp(shadow, data, size) == 0)
+    {
+        s_UniformStats.Skipped++;
+        return false;
+    }
+
+    memcpy(shadow, data, size);
+    /* A partial array write leaves the tail unknown, only a full write makes the copy trustworthy. */
+    info.ShadowValid = info.ShadowValid || size == info.ShadowSize;
+    s_UniformStats.Uploaded++;
+    return true;
+}
+
+void Shader::SetUniformMat4f(int handle, const glm::mat4& matrix)
+{
+    if (handle < 0 || !UpdateUniformValue(handle, &matrix[0][0], sizeof(glm::mat4)))
+        return;
+    if (ProgramUniformsSupported())
+    {
+        GLCall(glProgramUniformMatrix4fv(m_RenderID, m_Uniforms[handle].Location, 1, GL_FALSE, &matrix[0][0]));
+        return;
+    }
+    Bind();
+    GLCall(glUniformMatrix4fv(m_Uniforms[handle].Location, 1, GL_FALSE, &matrix[0][0]));
+}
+
+void Shader::SetUniform1i(int handle, int value)
+{
+    if (handle < 0 || !UpdateUniformValue(handle, &value, sizeof(int)))
+        return;
+    if (ProgramUniformsSupported())
+    {
+        GLCall(glProgramUniform1i(m_RenderID, m_Uniforms[handle].Location, value));
+        return;
+    }
+    Bind();
+    GLCall(glUniform1i(m_Uniforms[handle].Location, value));
+}
+
+void Shader::SetUniform1iv(int handle, int count, const int* values)
+{
+    if (handle < 0 || !UpdateUniformValue(handle, values, count * sizeof(int)))
+        return;
+    if (ProgramUniformsSupported())
+    {
+        GLCall(glProgramUniform1iv(m_RenderID, m_Uniforms[handle].Location, count, values));
+        return;
+    }
+    Bind();
+    GLCall(glUniform1iv(m_Uniforms[handle].Location, count, values));
+}
+
+void Shader::SetUniform4f(int handle, float v0, float v1, float v2, float v3)
+{
+    float values[4] = { v0, v1, v2, v3 };
+    if (handle < 0 || !UpdateUniformValue(handle, values, sizeof(values)))
+        return;
+    if (ProgramUniformsSupported())
+    {
+        GLCall(glProgramUniform4f(m_RenderID, m_Uniforms[handle].Location, v0, v1, v2, v3));
+        return;
+    }
+    Bind();
+    GLCall(glUniform4f(m_Uniforms[handle].Location, v0, v1, v2, v3));
+}
+
+void Shader::SetUniformMat4f(UniformName name, const glm::mat4& matrix)
+{
+    SetUniformMat4f(GetUniformHandle(name), matrix);
 }
 
-void Shader::SetUniformMat4f(const std::string& name, const glm::mat4& matrix)
+void Shader::SetUniform1i(UniformName name, int value)
 {
-    GLCall(glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &matrix[0][0]));
+    SetUniform1i(GetUniformHandle(name), value);
 }
 
-void Shader::SetUniform1i(const std::string& name, int value)
+void Shader::SetUniform1iv(UniformName name, int count, const int* values)
 {
-    GLCall(glUniform1i(GetUniformLocation(name), value));
+    SetUniform1iv(GetUniformHandle(name), count, values);
+}
+
+void Shader::SetUniform4f(UniformName name, float v0, float v1, float v2, float v3)
+{
+    SetUniform4f(GetUniformHandle(name), v0, v1, v2, v3);
+}
+
+int Shader::GetUniformHandle(UniformName name) const
+{
+    /* Uniforms only exist once the program is linked. */
+    WaitUntilReady();
+
+    auto it = std::lower_bound(m_Uniforms.begin(), m_Uniforms.end(), name.Hash,
+        [](const UniformInfo& info, uint32_t hash) { return info.Hash < hash; });
+    if (!m_HashCollision)
+    {
+        if (it != m_Uniforms.end() && it->Hash == name.Hash)
+            return (int)(it - m_Uniforms.begin());
+    }
+    else
+    {
+        size_t length = GetUniformNameLength(name.Name);
+        for (; it != m_Uniforms.end() && it->Hash == name.Hash; ++it)
+        {
+            if (GetUniformNameLength(it->Name.c_str()) == length && it->Name.compare(0, length, name.Name, length) == 0)
+                return (int)(it - m_Uniforms.begin());
+        }
+    }
+
+    if (std::find(m_MissingUniforms.begin(), m_MissingUniforms.end(), name.Hash) == m_MissingUniforms.end())
+    {
+        std::cout << "Warning: uniform " << name.Name << " doesn't Exist!" << std::endl;
+        m_MissingUniforms.push_back(name.Hash);
+    }
+    return -1;
 }
 
-void Shader::SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3)
+bool Shader::ReadsDrawData() const
 {
-    GLCall(glUniform4f(GetUniformLocation(name), v0, v1, v2, v3));
+    WaitUntilReady();
+    return m_HasDrawData;
 }
 
-int Shader::GetUniformLocation(const std::string& name)
+bool Shader::HasUniform(UniformName name) const
 {
-    if (M_UniformLocationCache.find(name) != M_UniformLocationCache.end()) 
+    WaitUntilReady();
+
+    size_t length = GetUniformNameLength(name.Name);
+    auto it = std::lower_bound(m_Uniforms.begin(), m_Uniforms.end(), name.Hash,
+        [](const UniformInfo& info, uint32_t hash) { return info.Hash < hash; });
+    for (; it != m_Uniforms.end() && it->Hash == name.Hash; ++it)
     {
-        return M_UniformLocationCache[name];
+        if (!m_HashCollision || (GetUniformNameLength(it->Name.c_str()) == length && it->Name.compare(0, length, name.Name, length) == 0))
+            return true;
     }
+    return false;
+}
 
-    GLCall(int location = glGetUniformLocation(m_RenderID, name.c_str()));
-    if (location == -1)
+unsigned int Shader::GetUniformBlockIndex(UniformName name) const
+{
+    WaitUntilReady();
+
+    /* Few blocks per program, so the name is always compared, the hash only rejects quickly. */
+    for (const UniformBlockInfo& block : m_UniformBlocks)
     {
-        std::cout << "Warning: uniform " << name << " doesn't Exist!" << std::endl;
+        if (block.Hash == name.Hash && block.Name == name.Name)
+            return block.Index;
     }
+    return GL_INVALID_INDEX;
+}
 
-    M_UniformLocationCache[name] = location;
-    return location;
-}
\ No newline at end of file
+void Shader::BindUniformBlock(UniformName name, unsigned int binding) const
+{
+    unsigned int index = GetUniformBlockIndex(name);
+    if (index == GL_INVALID_INDEX)
+    {
+        std::cout << "Warning: uniform block " << name.Name << " doesn't Exist!" << std::endl;
+        return;
+    }
+
+    GLCall(glUniformBlockBinding(m_RenderID, index, binding));
+}
+
+void Shader::Reflect() const
+{
+    int count = 0, maxLength = 0;
+    GLCall(glGetProgramiv(m_RenderID, GL_ACTIVE_UNIFORMS, &count));
+    GLCall(glGetProgramiv(m_RenderID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength));
+
+    std::vector<char> name(maxLength + 1);
+    m_Uniforms.clear();
+    m_Uniforms.reserve(count);
+    m_UniformValues.clear();
+    for (int i = 0; i < count; i++)
+    {
+        UniformInfo info;
+        GLsizei length = 0;
+        GLCall(glGetActiveUniform(m_RenderID, i, (GLsizei)name.size(), &length, &info.Size, &info.Type, name.data()));
+
+        unsigned int index = i;
+        GLCall(glGetActiveUniformsiv(m_RenderID, 1, &index, GL_UNIFORM_BLOCK_INDEX, &info.BlockIndex));
+
+        info.Name.assign(name.data(), length);
+        info.Hash = HashUniformName(info.Name.c_str());
+        GLCall(info.Location = glGetUniformLocation(m_RenderID, info.Name.c_str()));
+
+        /* Block members are set through buffers, only default block uniforms get a shadow copy. */
+        info.ShadowOffset = (unsigned int)m_UniformValues.size();
+        info.ShadowSize = info.BlockIndex == -1 ? GetUniformTypeSize(info.Type) * info.Size : 0;
+        info.ShadowValid = false;
+        m_UniformValues.resize(m_UniformValues.size() + info.ShadowSize);
+
+        m_Uniforms.push_back(info);
+    }
+
+    std::sort(m_Uniforms.begin(), m_Uniforms.end(),
+        [](const UniformInfo& a, const UniformInfo& b) { return a.Hash < b.Hash; });
+    m_HashCollision = false;
+    for (size_t i = 1; i < m_Uniforms.size(); i++)
+    {
+        /* Rare but legal, lookups fall back to comparing names for this shader. */
+        if (m_Uniforms[i - 1].Hash == m_Uniforms[i].Hash)
+        {
+            std::cout << "Warning: uniforms " << m_Uniforms[i - 1].Name << " and " << m_Uniforms[i].Name
+                << " share a hash in " << m_Filepath << ", looking them up by name" << std::endl;
+            m_HashCollision = true;
+        }
+    }
+
+    count = 0;
+    maxLength = 0;
+    GLCall(glGetProgramiv(m_RenderID, GL_ACTIVE_UNIFORM_BLOCKS, &count));
+    GLCall(glGetProgramiv(m_RenderID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength));
+
+    name.resize(maxLength + 1);
+    m_UniformBlocks.clear();
+    for (int i = 0; i < count; i++)
+    {
+        UniformBlockInfo block;
+        GLsizei length = 0;
+        GLCall(glGetActiveUniformBlockName(m_RenderID, i, (GLsizei)name.size(), &length, name.data()));
+        GLCall(glGetActiveUniformBlockiv(m_RenderID, i, GL_UNIFORM_BLOCK_DATA_SIZE, &block.DataSize));
+
+        block.Name.assign(name.data(), length);
+        block.Hash = HashUniformName(block.Name.c_str());
+        block.Index = i;
+        m_UniformBlocks.push_back(block);
+    }
+
+    /* Storage blocks and program interface queries are both 4.3. */
+    m_HasDrawData = false;
+    if (GLEW_VERSION_4_3 || GLEW_ARB_program_interface_query)
+    {
+        unsigned int drawData;
+        GLCall(drawData = glGetProgramResourceIndex(m_RenderID, GL_SHADER_STORAGE_BLOCK, "DrawData"));
+        m_HasDrawData = drawData != GL_INVALID_INDEX;
+    }
+}
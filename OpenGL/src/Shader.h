@@ -6,7 +6,9 @@
 #include <string>
 #include <sstream>
 #include <GL/glew.h>
-#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <chrono>
 
 #include "glm/glm.hpp"
 
@@ -18,27 +20,187 @@ struct ShaderProgramSource
 	std::string FragmentSource;
 };
 
+/* Length of a uniform name without a trailing "[0]", so "u_Textures[0]", as the driver reports plain arrays,
+matches "u_Textures". Members of struct arrays like "u_Lights[1].Color" keep their whole name. */
+constexpr size_t GetUniformNameLength(const char* name)
+{
+	size_t length = 0;
+	while (name[length])
+		length++;
+	if (length > 3 && name[length - 3] == '[' && name[length - 2] == '0' && name[length - 1] == ']')
+		length -= 3;
+	return length;
+}
+
+/* FNV-1a of a uniform name, see GetUniformNameLength. */
+constexpr uint32_t HashUniformName(const char* name)
+{
+	uint32_t hash = 2166136261u;
+	size_t length = GetUniformNameLength(name);
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= (unsigned char)name[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/* Uniform name plus its hash. Declare as constexpr to hash at compile time,
+converting a literal on the fly hashes it on every call but never allocates. */
+struct UniformName
+{
+	const char* Name;
+	uint32_t Hash;
+
+	constexpr UniformName(const char* name)
+		:Name(name), Hash(HashUniformName(name)) {}
+};
+
+/* One active uniform, filled in from glGetActiveUniform once the program is linked. */
+struct UniformInfo
+{
+	uint32_t Hash;
+	int Location;
+	unsigned int Type;
+	/* Number of array elements, 1 for plain uniforms. */
+	int Size;
+	/* Uniform block the uniform lives in, -1 for the default block. */
+	int BlockIndex;
+	std::string Name;
+	/* Last uploaded value lives at this offset of the shader's shadow storage, size 0 if not tracked. */
+	unsigned int ShadowOffset;
+	unsigned int ShadowSize;
+	bool ShadowValid;
+};
+
+struct UniformBlockInfo
+{
+	uint32_t Hash;
+	unsigned int Index;
+	int DataSize;
+	std::string Name;
+};
+
+/* Per frame counters of glUniform calls made and skipped because the value was unchanged. */
+struct UniformStats
+{
+	unsigned int Uploaded = 0;
+	unsigned int Skipped = 0;
+};
+
+/* Startup metrics of the on-disk program binary cache, accumulated over all shaders. */
+struct ShaderCacheStats
+{
+	unsigned int Hits = 0;
+	unsigned int Misses = 0;
+	/* Binaries found on disk but refused by the driver, these are compiled from source. */
+	unsigned int Rejected = 0;
+	/* From submitting the sources until the driver was first seen done, by an IsReady poll or
+	by the blocking link status query of WaitUntilReady. */
+	double CompileMilliseconds = 0.0;
+	double LoadMilliseconds = 0.0;
+	/* Compile time recorded with each binary minus the time it took to load it. */
+	double SavedMilliseconds = 0.0;
+};
+
 class Shader
 {
 
 private:
 	std::string m_Filepath;
+	/* 0 once moved from. */
 	unsigned int m_RenderID;
-	std::unordered_map<std::string, int> M_UniformLocationCache;
+	/* Reflection tables sorted by hash, handles are indices into m_Uniforms. */
+	mutable std::vector<UniformInfo> m_Uniforms;
+	mutable std::vector<UniformBlockInfo> m_UniformBlocks;
+	/* Set when two uniform names share a hash, lookups then compare names as well. */
+	mutable bool m_HashCollision;
+	/* Whether the program declares the DrawData storage block, see ReadsDrawData. */
+	mutable bool m_HasDrawData;
+	/* Names already warned about, so a missing uniform is only reported once. */
+	mutable std::vector<uint32_t> m_MissingUniforms;
+	/* CPU copy of every default block uniform value, compared before each upload. */
+	mutable std::vector<unsigned char> m_UniformValues;
+
+	/* Compiling until the driver reports the link finished, resolved lazily so construction never blocks. */
+	enum class Status
+	{
+		Compiling, Ready, Failed
+	};
+	mutable Status m_Status;
+	mutable unsigned int m_VertexID, m_FragmentID;
+	uint64_t m_CacheKey;
+	std::chrono::high_resolution_clock::time_point m_CompileStart;
+	/* Taken by the first poll that sees the link finished, negative until then. */
+	mutable double m_CompileMilliseconds;
 
-	int GetUniformLocation(const std::string& name);
+	void Release();
+	/* Builds the reflection tables, called once when the program is linked. */
+	void Reflect() const;
+	/* Stores the value in the shadow copy, returns false if it is unchanged and the upload can be skipped. */
+	bool UpdateUniformValue(int handle, const void* data, unsigned int size);
 	unsigned int Createshader(const std::string& vertexShader, const std::string& fragmentShader);
 	unsigned int CompilerShader(unsigned int type, const std::string& source);
+	bool CheckShader(unsigned int id) const;
+	/* Collects compile and link results, blocks if the driver is not done yet. */
+	void Resolve() const;
+	/* Program binaries are cached next to the shader file, keyed by source and driver. */
+	uint64_t MakeCacheKey(const std::string& vertexShader, const std::string& fragmentShader) const;
+	unsigned int LoadProgramBinary(uint64_t key);
+	void SaveProgramBinary(unsigned int program, uint64_t key, double compileMilliseconds) const;
 	ShaderProgramSource ParseShader(const std::string& filepath);
 
 public:
 	Shader(const std::string& filepath);
 	~Shader();
 
+	/* Move only, a copy would delete the same GL program twice. A moved from shader reports failed. */
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
+	Shader(Shader&& other) noexcept;
+	Shader& operator=(Shader&& other) noexcept;
+
 	void Bind() const;
 	void Unbind() const;
+
+	/* Never blocks when KHR_parallel_shader_compile is available, draws skip shaders that aren't ready. */
+	bool IsReady() const;
+	bool HasFailed() const;
+	void WaitUntilReady() const;
+
+	/* Lets the driver compile on as many threads as it likes, call once after glewInit. */
+	static void EnableParallelCompile();
+
+	static const ShaderCacheStats& GetCacheStats();
+	static const UniformStats& GetUniformStats();
+	/* Call once per frame to get per frame counters. */
+	static void ResetUniformStats();
+
+	inline unsigned int GetRendererID() const { return m_RenderID; }
+
+	/* Handle for the SetUniform overloads, or -1 if the uniform isn't active. Waits for the link. */
+	int GetUniformHandle(UniformName name) const;
+	/* Whether the uniform is active, never warns. Waits for the link. */
+	bool HasUniform(UniformName name) const;
+	/* Whether the program reads per-draw model matrices from the DrawData storage block, indexed by
+	gl_BaseInstance + gl_InstanceID. Renderer::Flush only merges differing transforms for these. Waits for the link. */
+	bool ReadsDrawData() const;
+	/* Index of the uniform block, or GL_INVALID_INDEX. Waits for the link. */
+	unsigned int GetUniformBlockIndex(UniformName name) const;
+	/* For shaders without a layout(binding = n) qualifier on the block. */
+	void BindUniformBlock(UniformName name, unsigned int binding) const;
+	inline const std::vector<UniformInfo>& GetUniforms() const { WaitUntilReady(); return m_Uniforms; }
+	inline const std::vector<UniformBlockInfo>& GetUniformBlocks() const { WaitUntilReady(); return m_UniformBlocks; }
 	
-	void SetUniformMat4f(const std::string& name, const glm::mat4& matrix);
-	void SetUniform1i(const std::string& name, int value);
-	void SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3);
+	/* Setting through a handle skips the name lookup entirely. The shader doesn't have to be bound, values go to this
+	program by name (glProgramUniform, 4.1) or it is bound first. */
+	void SetUniformMat4f(int handle, const glm::mat4& matrix);
+	void SetUniform1i(int handle, int value);
+	void SetUniform1iv(int handle, int count, const int* values);
+	void SetUniform4f(int handle, float v0, float v1, float v2, float v3);
+
+	void SetUniformMat4f(UniformName name, const glm::mat4& matrix);
+	void SetUniform1i(UniformName name, int value);
+	void SetUniform1iv(UniformName name, int count, const int* values);
+	void SetUniform4f(UniformName name, float v0, float v1, float v2, float v3);
 };
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "StreamingVertexBuffer.h"
+#include "Renderer.h"
+#include "GLState.h"
+
+StreamingVertexBuffer::StreamingVertexBuffer(unsigned int regionSize)
+	:m_RenderID(0), m_RegionSize(regionSize), m_MappedData(nullptr),
+	m_Region(0), m_Offset(0), m_Stalls(0)
+{
+	/* Persistent mapping needs glBufferStorage, core since 4.4. */
+	ASSERT(GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+
+	for (unsigned int i = 0; i < RegionCount; i++)
+		m_Fences[i] = nullptr;
+
+	unsigned int size = m_RegionSize * RegionCount;
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	/* Mapped once for the lifetime of the buffer, coherent so writes don't need explicit flushes. */
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glCreateBuffers(1, &m_RenderID));
+		GLCall(glNamedBufferStorage(m_RenderID, size, nullptr, flags));
+		GLCall(m_MappedData = (unsigned char*)glMapNamedBufferRange(m_RenderID, 0, size, flags));
+	}
+	else
+	{
+		GLCall(glGenBuffers(1, &m_RenderID));
+		GLState::BindBuffer(GL_ARRAY_BUFFER, m_RenderID);
+		GLCall(glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags));
+		GLCall(m_MappedData = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags));
+	}
+}
+
+StreamingVertexBuffer::~StreamingVertexBuffer()
+{
+	for (unsigned int i = 0; i < RegionCount; i++)
+	{
+		if (m_Fences[i])
+		{
+			GLCall(glDeleteSync(m_Fences[i]));
+		}
+	}
+
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glUnmapNamedBuffer(m_RenderID));
+	}
+	else
+	{
+		GLState::BindBuffer(GL_ARRAY_BUFFER, m_RenderID);
+		GLCall(glUnmapBuffer(GL_ARRAY_BUFFER));
+	}
+	GLState::ForgetBuffer(m_RenderID);
+	GLCall(glDeleteBuffers(1, &m_RenderID));
+}
+
+void StreamingVertexBuffer::BeginFrame()
+{
+	m_Region = (m_Region + 1) % RegionCount;
+	m_Offset = 0;
+
+	GLsync fence = m_Fences[m_Region];
+	if (!fence)
+		return;
+
+	/* Fast path: the GPU is already done with this region. */
+	GLenum result;
+	GLCall(result = glClientWaitSync(fence, 0, 0));
+	if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+	{
+		m_Stalls++;
+		do
+		{
+			/* Flush so the fence is guaranteed to signal eventually, wait in 1ms steps. */
+			GLCall(result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000));
+		} while (result == GL_TIMEOUT_EXPIRED);
+
+		ASSERT(result != GL_WAIT_FAILED);
+	}
+
+	GLCall(glDeleteSync(fence));
+	m_Fences[m_Region] = nullptr;
+}
+
+void StreamingVertexBuffer::EndFrame()
+{
+	if (m_Fences[m_Region])
+	{
+		GLCall(glDeleteSync(m_Fences[m_Region]));
+	}
+
+	GLCall(m_Fences[m_Region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+}
+
+void* StreamingVertexBuffer::Allocate(unsigned int size, unsigned int alignment, unsigned int& offset)
+{
+	unsigned int regionStart = m_Region * m_RegionSize;
+	unsigned int start = regionStart + m_Offset;
+	if (alignment > 1)
+		start = (start + alignment - 1) / alignment * alignment;
+
+	if (start + size > regionStart + m_RegionSize)
+		return nullptr;
+
+	m_Offset = start + size - regionStart;
+	offset = start;
+	return m_MappedData + start;
+}
+
+void StreamingVertexBuffer::Bind() const
+{
+	GLState::BindBuffer(GL_ARRAY_BUFFER, m_RenderID);
+}
+
+void StreamingVertexBuffer::Unbind() const
+{
+	GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+}
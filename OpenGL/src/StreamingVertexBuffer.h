@@ -0,0 +1,50 @@
+#pragma once
+
+#include <GL/glew.h>
+
+/* Vertex buffer for geometry that changes every frame. Storage is immutable and stays persistently mapped,
+it is split into RegionCount regions that are used round robin, one per frame (or per batch, see BatchRenderer). Each region is fenced when
+the frame ends and waited on before it is reused, so the CPU never overwrites data the GPU still reads. */
+class StreamingVertexBuffer
+{
+public:
+	/* Frames the CPU may run ahead of the GPU. */
+	static const unsigned int RegionCount = 3;
+
+private:
+	/* Id for openGl sate machine. */
+	unsigned int m_RenderID;
+	unsigned int m_RegionSize;
+	unsigned char* m_MappedData;
+	GLsync m_Fences[RegionCount];
+	unsigned int m_Region;
+	/* Write position inside the current region. */
+	unsigned int m_Offset;
+	/* Frames where BeginFrame had to wait for the GPU. */
+	unsigned int m_Stalls;
+
+public:
+	/* Size is the number of bytes available per frame. */
+	StreamingVertexBuffer(unsigned int regionSize);
+	~StreamingVertexBuffer();
+
+	StreamingVertexBuffer(const StreamingVertexBuffer&) = delete;
+	StreamingVertexBuffer& operator=(const StreamingVertexBuffer&) = delete;
+
+	/* Moves on to the next region and waits for the GPU to release it, call once before writing a frame. */
+	void BeginFrame();
+	/* Fences the current region, call after the last draw that reads this frame's data. */
+	void EndFrame();
+
+	/* Hands out size bytes of the current region aligned to alignment (use the vertex stride so the offset
+	works as a base vertex). offset receives the position from the start of the buffer.
+	Returns nullptr when the region is full. */
+	void* Allocate(unsigned int size, unsigned int alignment, unsigned int& offset);
+
+	void Bind() const;
+	void Unbind() const;
+
+	inline unsigned int GetRendererID() const { return m_RenderID; }
+	inline unsigned int GetRegionSize() const { return m_RegionSize; }
+	inline unsigned int GetStallCount() const { return m_Stalls; }
+};
@@ -1,44 +1,385 @@
 #include "Texture.h"
+#include "GLState.h"
+#include "MappedFile.h"
+#include "CompressedImage.h"
+#include "BlockDecoder.h"
 #include "stb_image/stb_image.h"
 
-Texture::Texture(const std::string& path)
+#include <cstdint>
+#include <iostream>
+
+Texture::Texture(const std::string& path, bool flipVertically)
 	:m_RendererID(0), m_FilePath(path), m_LocalBuffer(nullptr),
-	m_Width(0), m_Height(0), m_BPP(0)
+	m_Width(0), m_Height(0), m_BPP(0), m_MipCount(0), m_InternalFormat(0), m_MemorySize(0),
+	m_Filter(TextureFilter::Trilinear), m_Anisotropy(1.0f), m_Loaded(false)
 {
-	/* Flip because way image is stored. */
-	stbi_set_flip_vertically_on_load(1);
+	Create();
+
+	if (IsCompressedImagePath(path))
+	{
+		LoadCompressed(path);
+		return;
+	}
+
+	/* Flip because way image is stored. Thread local, so decodes on other threads are unaffected. */
+	stbi_set_flip_vertically_on_load_thread(flipVertically);
 	m_LocalBuffer = stbi_load(path.c_str(), &m_Width, &m_Height, &m_BPP, 4);
 
+	/* If Local Buffer isn't empty, upload and free it.*/
+	if (m_LocalBuffer)
+	{
+		SetData(m_Width, m_Height, m_LocalBuffer);
+		stbi_image_free(m_LocalBuffer);
+		m_LocalBuffer = nullptr;
+	}
+	else
+		std::cout << "[Texture Error] (" << path << "): " << stbi_failure_reason() << std::endl;
+}
+
+Texture::Texture(int width, int height, const void* pixels)
+	:m_RendererID(0), m_LocalBuffer(nullptr),
+	m_Width(0), m_Height(0), m_BPP(4), m_MipCount(0), m_InternalFormat(0), m_MemorySize(0),
+	m_Filter(TextureFilter::Trilinear), m_Anisotropy(1.0f), m_Loaded(false)
+{
+	Create();
+	SetData(width, height, pixels);
+}
+
+Texture::Texture()
+	:m_RendererID(0), m_LocalBuffer(nullptr),
+	m_Width(0), m_Height(0), m_BPP(4), m_MipCount(0), m_InternalFormat(0), m_MemorySize(0),
+	m_Filter(TextureFilter::Trilinear), m_Anisotropy(1.0f), m_Loaded(false)
+{
+	/* Magenta and black checkerboard, hard to miss if a texture never finishes loading. */
+	const unsigned int checker[] = { 0xffff00ff, 0xff000000, 0xff000000, 0xffff00ff };
+
+	Create();
+	SetData(2, 2, checker);
+	m_Loaded = false;
+}
+
+Texture::~Texture()
+{
+	Release();
+}
+
+Texture::Texture(Texture&& other) noexcept
+	:m_RendererID(other.m_RendererID), m_FilePath(std::move(other.m_FilePath)), m_LocalBuffer(nullptr),
+	m_Width(other.m_Width), m_Height(other.m_Height), m_BPP(other.m_BPP), m_MipCount(other.m_MipCount),
+	m_InternalFormat(other.m_InternalFormat), m_MemorySize(other.m_MemorySize),
+	m_Filter(other.m_Filter), m_Anisotropy(other.m_Anisotropy), m_Loaded(other.m_Loaded)
+{
+	other.m_RendererID = 0;
+	other.m_InternalFormat = 0;
+	other.m_MemorySize = 0;
+	other.m_Loaded = false;
+}
+
+Texture& Texture::operator=(Texture&& other) noexcept
+{
+	if (this != &other)
+	{
+		Release();
+		m_RendererID = other.m_RendererID;
+		m_FilePath = std::move(other.m_FilePath);
+		m_Width = other.m_Width;
+		m_Height = other.m_Height;
+		m_BPP = other.m_BPP;
+		m_MipCount = other.m_MipCount;
+		m_InternalFormat = other.m_InternalFormat;
+		m_MemorySize = other.m_MemorySize;
+		m_Filter = other.m_Filter;
+		m_Anisotropy = other.m_Anisotropy;
+		m_Loaded = other.m_Loaded;
+
+		other.m_RendererID = 0;
+		other.m_InternalFormat = 0;
+		other.m_MemorySize = 0;
+		other.m_Loaded = false;
+	}
+	return *this;
+}
+
+void Texture::Release()
+{
+	if (m_RendererID == 0)
+		return;
+
+	GLState::ForgetTexture(m_RendererID);
+	GLCall(glDeleteTextures(1, &m_RendererID));
+	m_RendererID = 0;
+}
+
+int Texture::GetMipCount(int width, int height)
+{
+	int levels = 1;
+	int size = width > height ? width : height;
+	while (size > 1)
+	{
+		size >>= 1;
+		levels++;
+	}
+	return levels;
+}
+
+void Texture::Create()
+{
+	/* glTexStorage2D, core since 4.2. With direct state access everything below works by name. */
+	ASSERT(GLEW_VERSION_4_2 || GLEW_ARB_texture_storage);
+
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glCreateTextures(GL_TEXTURE_2D, 1, &m_RendererID));
+		GLCall(glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+		GLCall(glTextureParameteri(m_RendererID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+		return;
+	}
+
 	GLCall(glGenTextures(1, &m_RendererID));
-	GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+	GLState::BindTexture(0, GL_TEXTURE_2D, m_RendererID);
 
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
-	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
 	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
 	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
 
-	GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_LocalBuffer));
-	
 	/* Unbind */
-	GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+	GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+}
 
-	/* If Local Buffer isn't empty, free it.*/
-	if (m_LocalBuffer)
-		stbi_image_free(m_LocalBuffer);
+void Texture::AllocateStorage(int width, int height, int mipCount, unsigned int internalFormat)
+{
+	if (m_InternalFormat == internalFormat && m_Width == width && m_Height == height && m_MipCount == mipCount)
+		return;
+
+	if (m_InternalFormat != 0)
+	{
+		Release();
+		Create();
+	}
+
+	m_Width = width;
+	m_Height = height;
+	m_MipCount = mipCount;
+	m_InternalFormat = internalFormat;
+
+	/* Block compressed formats store 4x4 blocks of 8 or 16 bytes, everything else here is 4 bytes per pixel. */
+	bool compressed = internalFormat != GL_RGBA8 && internalFormat != GL_SRGB8_ALPHA8;
+	bool smallBlocks = internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+		|| internalFormat == GL_COMPRESSED_RED_RGTC1;
+	m_MemorySize = 0;
+	for (int i = 0, w = width, h = height; i < mipCount; i++, w = w > 1 ? w / 2 : 1, h = h > 1 ? h / 2 : 1)
+		m_MemorySize += compressed ? (size_t)((w + 3) / 4) * ((h + 3) / 4) * (smallBlocks ? 8 : 16) : (size_t)w * h * 4;
+
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glTextureStorage2D(m_RendererID, m_MipCount, m_InternalFormat, m_Width, m_Height));
+	}
+	else
+	{
+		GLState::BindTexture(0, GL_TEXTURE_2D, m_RendererID);
+		GLCall(glTexStorage2D(GL_TEXTURE_2D, m_MipCount, m_InternalFormat, m_Width, m_Height));
+		GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+	}
+
+	/* The min filter depends on whether there are mips. */
+	ApplyFilter();
 }
 
-Texture::~Texture()
+void Texture::SetFilter(TextureFilter filter, float anisotropy)
 {
-	GLCall(glDeleteTextures(1, &m_RendererID));
+	m_Filter = filter;
+	m_Anisotropy = anisotropy;
+	ApplyFilter();
+}
+
+void Texture::ApplyFilter()
+{
+	bool mipmapped = m_MipCount > 1;
+	int minFilter, magFilter;
+	switch (m_Filter)
+	{
+	case TextureFilter::Nearest:
+		minFilter = mipmapped ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST;
+		magFilter = GL_NEAREST;
+		break;
+	case TextureFilter::Bilinear:
+		minFilter = mipmapped ? GL_LINEAR_MIPMAP_NEAREST : GL_LINEAR;
+		magFilter = GL_LINEAR;
+		break;
+	default:
+		minFilter = mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+		magFilter = GL_LINEAR;
+		break;
+	}
+
+	/* Core since 4.6, an extension everywhere else. */
+	float anisotropy = 0.0f;
+	if (GLEW_VERSION_4_6 || GLEW_ARB_texture_filter_anisotropic || GLEW_EXT_texture_filter_anisotropic)
+	{
+		static float maxAnisotropy = 0.0f;
+		if (maxAnisotropy == 0.0f)
+		{
+			GLCall(glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &maxAnisotropy));
+		}
+
+		anisotropy = m_Anisotropy < 1.0f ? 1.0f : m_Anisotropy > maxAnisotropy ? maxAnisotropy : m_Anisotropy;
+	}
+
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glTextureParameteri(m_RendererID, GL_TEXTURE_MIN_FILTER, minFilter));
+		GLCall(glTextureParameteri(m_RendererID, GL_TEXTURE_MAG_FILTER, magFilter));
+		if (anisotropy > 0.0f)
+		{
+			GLCall(glTextureParameterf(m_RendererID, GL_TEXTURE_MAX_ANISOTROPY, anisotropy));
+		}
+		return;
+	}
+
+	GLState::BindTexture(0, GL_TEXTURE_2D, m_RendererID);
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter));
+	GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter));
+	if (anisotropy > 0.0f)
+	{
+		GLCall(glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, anisotropy));
+	}
+	GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+}
+
+void Texture::LoadCompressed(const std::string& path)
+{
+	MappedFile file(path);
+	if (!file.IsOpen())
+	{
+		std::cout << "[Texture Error] (" << path << "): could not open file" << std::endl;
+		return;
+	}
+
+	CompressedImage image;
+	std::string error;
+	if (!ParseCompressedImage(file.GetData(), file.GetSize(), image, error))
+	{
+		std::cout << "[Texture Error] (" << path << "): " << error << std::endl;
+		return;
+	}
+
+	SetCompressedData(image);
+}
+
+void Texture::SetCompressedData(const CompressedImage& image)
+{
+	bool native = IsBlockFormatSupported(image.Format);
+	unsigned int internalFormat = native ? GetCompressedInternalFormat(image.Format, image.SRGB)
+		: image.SRGB ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+
+	/* Only the levels the file provides, block compressed formats can't have mips generated. */
+	AllocateStorage(image.Width, image.Height, (int)image.Levels.size(), internalFormat);
+
+	std::vector<unsigned char> decoded;
+	bool dsa = GLState::HasDirectStateAccess();
+	if (!dsa)
+		GLState::BindTexture(0, GL_TEXTURE_2D, m_RendererID);
+	for (int i = 0; i < m_MipCount; i++)
+	{
+		const CompressedLevel& level = image.Levels[i];
+		const void* pixels = level.Data;
+		if (!native)
+		{
+			decoded.resize((size_t)level.Width * level.Height * 4);
+			DecodeBlockImage(image.Format, level.Data, level.Width, level.Height, decoded.data());
+			pixels = decoded.data();
+		}
+
+		if (native && dsa)
+		{
+			GLCall(glCompressedTextureSubImage2D(m_RendererID, i, 0, 0, level.Width, level.Height, internalFormat, level.Size, pixels));
+		}
+		else if (native)
+		{
+			GLCall(glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level.Width, level.Height, internalFormat, level.Size, pixels));
+		}
+		else if (dsa)
+		{
+			GLCall(glTextureSubImage2D(m_RendererID, i, 0, 0, level.Width, level.Height, GL_RGBA, GL_UNSIGNED_BYTE, pixels));
+		}
+		else
+		{
+			GLCall(glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level.Width, level.Height, GL_RGBA, GL_UNSIGNED_BYTE, pixels));
+		}
+	}
+	if (!dsa)
+		GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+
+	m_Loaded = true;
+}
+
+void Texture::SetData(int width, int height, const void* pixels)
+{
+	if (width <= 0 || height <= 0)
+		return;
+
+	AllocateStorage(width, height, GetMipCount(width, height), GL_RGBA8);
+
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glTextureSubImage2D(m_RendererID, 0, 0, 0, m_Width, m_Height, GL_RGBA, GL_UNSIGNED_BYTE, pixels));
+		if (m_MipCount > 1)
+		{
+			GLCall(glGenerateTextureMipmap(m_RendererID));
+		}
+	}
+	else
+	{
+		GLState::BindTexture(0, GL_TEXTURE_2D, m_RendererID);
+		GLCall(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, m_Width, m_Height, GL_RGBA, GL_UNSIGNED_BYTE, pixels));
+		if (m_MipCount > 1)
+		{
+			GLCall(glGenerateMipmap(GL_TEXTURE_2D));
+		}
+		GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+	}
+
+	m_Loaded = true;
+}
+
+void Texture::SetMipData(int width, int height, int mipCount, const void* pixels)
+{
+	if (width <= 0 || height <= 0)
+		return;
+
+	AllocateStorage(width, height, mipCount, GL_RGBA8);
+
+	/* Offsets are added as integers, pixels is null when reading from an unpack buffer. */
+	uintptr_t offset = (uintptr_t)pixels;
+
+	bool dsa = GLState::HasDirectStateAccess();
+	if (!dsa)
+		GLState::BindTexture(0, GL_TEXTURE_2D, m_RendererID);
+	for (int i = 0; i < m_MipCount; i++)
+	{
+		if (dsa)
+		{
+			GLCall(glTextureSubImage2D(m_RendererID, i, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)offset));
+		}
+		else
+		{
+			GLCall(glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)offset));
+		}
+		offset += (uintptr_t)width * height * 4;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	if (!dsa)
+		GLState::BindTexture(0, GL_TEXTURE_2D, 0);
+
+	m_Loaded = true;
 }
 
 void Texture::Bind(unsigned int slot) const
 {
-	GLCall(glActiveTexture(GL_TEXTURE0 + slot));
-	GLCall(glBindTexture(GL_TEXTURE_2D, m_RendererID));
+	GLState::BindTexture(slot, GL_TEXTURE_2D, m_RendererID);
 }
 
-void Texture::Unbind() const
+void Texture::Unbind(unsigned int slot) const
 {
-	GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+	GLState::BindTexture(slot, GL_TEXTURE_2D, 0);
 }
@@ -2,21 +2,81 @@
 
 #include "Renderer.h"
 
+struct CompressedImage;
+
+enum class TextureFilter
+{
+	Nearest,
+	/* Linear inside a mip level, nearest level. */
+	Bilinear,
+	/* Linear inside and between mip levels. */
+	Trilinear
+};
+
 class Texture
 {
 private:
+	/* 0 once moved from. */
 	unsigned int m_RendererID;
 	std::string m_FilePath;
 	unsigned char* m_LocalBuffer;
 	int m_Width, m_Height, m_BPP;
+	int m_MipCount;
+	/* Format of the immutable storage, 0 until it is allocated. */
+	unsigned int m_InternalFormat;
+	/* Estimated GPU memory of all levels. */
+	size_t m_MemorySize;
+	TextureFilter m_Filter;
+	float m_Anisotropy;
+	/* False while the placeholder is shown. */
+	bool m_Loaded;
+
+	/* Generates the GL texture and sets the wrap mode, storage is allocated on the first upload. */
+	void Create();
+	void Release();
+	/* Storage is immutable, a different size or format needs a new texture object. */
+	void AllocateStorage(int width, int height, int mipCount, unsigned int internalFormat);
+	void ApplyFilter();
+	/* Maps a DDS or KTX2 file and uploads its blocks straight from the mapping. */
+	void LoadCompressed(const std::string& path);
 
 public:
-	Texture(const std::string& path);
+	/* Decodes and uploads synchronously on the calling thread. DDS and KTX2 files keep their block
+	compression and mip chain, they are not flipped so they have to be stored bottom row first. */
+	Texture(const std::string& path, bool flipVertically = true);
+	/* Uploads width * height RGBA8 pixels that are already in memory, e.g. an atlas page. */
+	Texture(int width, int height, const void* pixels);
+	/* Placeholder checkerboard until SetData provides the real image, used by TextureLoader. */
+	Texture();
 	~Texture();
 
+	/* Move only, a copy would delete the same GL texture twice. */
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+	Texture(Texture&& other) noexcept;
+	Texture& operator=(Texture&& other) noexcept;
+
+	/* Levels in a full mip chain down to 1x1. */
+	static int GetMipCount(int width, int height);
+
+	/* Replaces the image with width * height RGBA8 pixels and generates the mip chain on the GPU.
+	When a GL_PIXEL_UNPACK_BUFFER is bound, pixels is a byte offset into that buffer. */
+	void SetData(int width, int height, const void* pixels);
+	/* Like SetData but with mipCount levels already built, packed one after the other starting with level 0. */
+	void SetMipData(int width, int height, int mipCount, const void* pixels);
+	/* Uploads every level of image, decoded to RGBA8 on the CPU if the context can't sample its format. */
+	void SetCompressedData(const CompressedImage& image);
+
+	/* Anisotropy above 1 sharpens surfaces seen at an angle, it is clamped to what the driver supports. */
+	void SetFilter(TextureFilter filter, float anisotropy = 1.0f);
+
 	void Bind(unsigned int slot = 0) const;
-	void Unbind() const;
+	void Unbind(unsigned int slot = 0) const;
 
 	inline int GetWidth() const		{ return m_Width; }
 	inline int GetHeight() const	{ return m_Height; }
-};
\ No newline at end of file
+	inline int GetMipCount() const	{ return m_MipCount; }
+	inline size_t GetMemorySize() const { return m_MemorySize; }
+	inline bool IsLoaded() const	{ return m_Loaded; }
+	inline unsigned int GetRendererID() const { return m_RendererID; }
+};
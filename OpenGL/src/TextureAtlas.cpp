@@ -0,0 +1,401 @@
+#include "TextureAtlas.h"
+#include "Texture.h"
+#include "stb_image/stb_image.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+	int AlignUp(int value, int alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	/* Uncompressed 32 bit TGA with a bottom left origin, which is the row order the pixels already have. */
+	bool WriteTGA(const std::string& path, int width, int height, const unsigned char* rgba)
+	{
+		std::ofstream stream(path, std::ios::binary);
+		if (!stream)
+			return false;
+
+		unsigned char header[18] = { 0 };
+		header[2] = 2;
+		header[12] = (unsigned char)(width & 0xff);
+		header[13] = (unsigned char)(width >> 8);
+		header[14] = (unsigned char)(height & 0xff);
+		header[15] = (unsigned char)(height >> 8);
+		header[16] = 32;
+		/* 8 alpha bits. */
+		header[17] = 8;
+		stream.write((const char*)header, sizeof(header));
+
+		/* TGA stores BGRA. */
+		std::vector<unsigned char> row((size_t)width * 4);
+		for (int y = 0; y < height; y++)
+		{
+			const unsigned char* source = rgba + (size_t)y * width * 4;
+			for (int x = 0; x < width; x++)
+			{
+				row[x * 4 + 0] = source[x * 4 + 2];
+				row[x * 4 + 1] = source[x * 4 + 1];
+				row[x * 4 + 2] = source[x * 4 + 0];
+				row[x * 4 + 3] = source[x * 4 + 3];
+			}
+			stream.write((const char*)row.data(), row.size());
+		}
+
+		return (bool)stream;
+	}
+}
+
+TextureAtlas::TextureAtlas(int pageSize, int padding)
+	:m_PageSize(pageSize), m_Padding(padding)
+{
+}
+
+TextureAtlas::~TextureAtlas()
+{
+}
+
+bool TextureAtlas::Add(const std::string& name, const std::string& path, bool flipVertically)
+{
+	int width, height, bpp;
+	stbi_set_flip_vertically_on_load_thread(flipVertically);
+	unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &bpp, 4);
+	if (!pixels)
+	{
+		std::cout << "[Atlas Error] (" << path << "): " << stbi_failure_reason() << std::endl;
+		return false;
+	}
+
+	Add(name, pixels, width, height);
+	stbi_image_free(pixels);
+	return true;
+}
+
+void TextureAtlas::Add(const std::string& name, const unsigned char* rgba, int width, int height)
+{
+	m_Pending.push_back({ name, width, height, std::vector<unsigned char>(rgba, rgba + (size_t)width * height * 4) });
+}
+
+bool TextureAtlas::Build()
+{
+	/* Largest first leaves the small images to fill the gaps. */
+	std::sort(m_Pending.begin(), m_Pending.end(), [](const Image& a, const Image& b)
+	{
+		int sideA = std::max(a.Width, a.Height);
+		int sideB = std::max(b.Width, b.Height);
+		if (sideA != sideB)
+			return sideA > sideB;
+		return a.Width * a.Height > b.Width * b.Height;
+	});
+
+	bool success = true;
+	for (const Image& image : m_Pending)
+	{
+		int width = AlignUp(image.Width + 2 * m_Padding, Alignment);
+		int height = AlignUp(image.Height + 2 * m_Padding, Alignment);
+		if (width > m_PageSize || height > m_PageSize)
+		{
+			std::cout << "[Atlas Error] (" << image.Name << "): " << image.Width << "x" << image.Height
+				<< " does not fit a " << m_PageSize << " page" << std::endl;
+			success = false;
+			continue;
+		}
+
+		Rect rect;
+		unsigned int page = 0;
+		while (page < m_Pages.size() && !Insert(m_Pages[page], width, height, rect))
+			page++;
+
+		if (page == m_Pages.size())
+		{
+			AddPage(m_PageSize, m_PageSize);
+			Insert(m_Pages[page], width, height, rect);
+		}
+
+		Blit(m_Pages[page], image, rect.X + m_Padding, rect.Y + m_Padding);
+
+		AtlasRegion region;
+		region.Page = page;
+		region.X = rect.X + m_Padding;
+		region.Y = rect.Y + m_Padding;
+		region.Width = image.Width;
+		region.Height = image.Height;
+		ComputeUVs(region);
+
+		/* Adding a name again replaces the region, the old pixels stay unused. */
+		auto existing = m_RegionIndex.find(image.Name);
+		if (existing != m_RegionIndex.end())
+			m_Regions[existing->second] = region;
+		else
+		{
+			m_RegionIndex[image.Name] = (unsigned int)m_Regions.size();
+			m_Regions.push_back(region);
+		}
+	}
+
+	m_Pending.clear();
+	return success;
+}
+
+void TextureAtlas::ComputeUVs(AtlasRegion& region) const
+{
+	const Page& page = m_Pages[region.Page];
+	region.UVMin = glm::vec2((float)region.X / page.Width, (float)region.Y / page.Height);
+	region.UVMax = glm::vec2((float)(region.X + region.Width) / page.Width, (float)(region.Y + region.Height) / page.Height);
+}
+
+void TextureAtlas::AddPage(int width, int height)
+{
+	Page page;
+	page.Width = width;
+	page.Height = height;
+	page.Pixels.assign((size_t)width * height * 4, 0);
+	page.FreeRects.push_back({ 0, 0, width, height });
+	page.Dirty = true;
+	m_Pages.push_back(std::move(page));
+}
+
+bool TextureAtlas::Insert(Page& page, int width, int height, Rect& result)
+{
+	int bestShortSide = INT_MAX;
+	int bestLongSide = INT_MAX;
+
+	for (const Rect& free : page.FreeRects)
+	{
+		if (free.Width < width || free.Height < height)
+			continue;
+
+		int leftoverX = free.Width - width;
+		int leftoverY = free.Height - height;
+		int shortSide = std::min(leftoverX, leftoverY);
+		int longSide = std::max(leftoverX, leftoverY);
+
+		if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+		{
+			bestShortSide = shortSide;
+			bestLongSide = longSide;
+			result = { free.X, free.Y, width, height };
+		}
+	}
+
+	if (bestShortSide == INT_MAX)
+		return false;
+
+	SplitFreeRects(page, result);
+	PruneFreeRects(page);
+	return true;
+}
+
+/* Every free rectangle overlapping the used one is replaced by the up to four maximal rectangles around it. */
+void TextureAtlas::SplitFreeRects(Page& page, const Rect& used)
+{
+	std::vector<Rect> next;
+	next.reserve(page.FreeRects.size() + 4);
+
+	for (const Rect& free : page.FreeRects)
+	{
+		if (used.X >= free.X + free.Width || used.X + used.Width <= free.X ||
+			used.Y >= free.Y + free.Height || used.Y + used.Height <= free.Y)
+		{
+			next.push_back(free);
+			continue;
+		}
+
+		if (used.X > free.X)
+			next.push_back({ free.X, free.Y, used.X - free.X, free.Height });
+		if (used.X + used.Width < free.X + free.Width)
+			next.push_back({ used.X + used.Width, free.Y, free.X + free.Width - used.X - used.Width, free.Height });
+		if (used.Y > free.Y)
+			next.push_back({ free.X, free.Y, free.Width, used.Y - free.Y });
+		if (used.Y + used.Height < free.Y + free.Height)
+			next.push_back({ free.X, used.Y + used.Height, free.Width, free.Y + free.Height - used.Y - used.Height });
+	}
+
+	page.FreeRects.swap(next);
+}
+
+/* Drops free rectangles that lie inside another one. */
+void TextureAtlas::PruneFreeRects(Page& page)
+{
+	std::vector<Rect>& rects = page.FreeRects;
+	std::vector<bool> removed(rects.size(), false);
+
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		for (size_t j = 0; j < rects.size() && !removed[i]; j++)
+		{
+			if (i == j || removed[j])
+				continue;
+
+			const Rect& a = rects[i];
+			const Rect& b = rects[j];
+			if (a.X >= b.X && a.Y >= b.Y && a.X + a.Width <= b.X + b.Width && a.Y + a.Height <= b.Y + b.Height)
+				removed[i] = true;
+		}
+	}
+
+	size_t kept = 0;
+	for (size_t i = 0; i < rects.size(); i++)
+	{
+		if (!removed[i])
+			rects[kept++] = rects[i];
+	}
+	rects.resize(kept);
+}
+
+void TextureAtlas::Blit(Page& page, const Image& image, int x, int y)
+{
+	for (int row = -m_Padding; row < image.Height + m_Padding; row++)
+	{
+		int sourceRow = std::min(std::max(row, 0), image.Height - 1);
+		unsigned char* destination = page.Pixels.data() + ((size_t)(y + row) * page.Width + x) * 4;
+
+		for (int column = -m_Padding; column < image.Width + m_Padding; column++)
+		{
+			int sourceColumn = std::min(std::max(column, 0), image.Width - 1);
+			memcpy(destination + column * 4, image.Pixels.data() + ((size_t)sourceRow * image.Width + sourceColumn) * 4, 4);
+		}
+	}
+
+	page.Dirty = true;
+}
+
+void TextureAtlas::Upload()
+{
+	for (Page& page : m_Pages)
+	{
+		if (!page.PageTexture)
+			page.PageTexture = std::make_unique<Texture>(page.Width, page.Height, page.Pixels.data());
+		else if (page.Dirty)
+			page.PageTexture->SetData(page.Width, page.Height, page.Pixels.data());
+
+		page.Dirty = false;
+	}
+}
+
+bool TextureAtlas::Save(const std::string& path) const
+{
+	size_t slash = path.find_last_of("/\\");
+	size_t dot = path.find_last_of('.');
+	std::string base = dot != std::string::npos && (slash == std::string::npos || dot > slash) ? path.substr(0, dot) : path;
+	std::string directory = slash != std::string::npos ? path.substr(0, slash + 1) : "";
+
+	std::ofstream stream(path);
+	if (!stream)
+	{
+		std::cout << "[Atlas Error] (" << path << "): could not write" << std::endl;
+		return false;
+	}
+
+	stream << "# TextureAtlas" << std::endl;
+	for (unsigned int i = 0; i < m_Pages.size(); i++)
+	{
+		const Page& page = m_Pages[i];
+		std::string file = base + "_" + std::to_string(i) + ".tga";
+		if (!WriteTGA(file, page.Width, page.Height, page.Pixels.data()))
+		{
+			std::cout << "[Atlas Error] (" << file << "): could not write" << std::endl;
+			return false;
+		}
+
+		/* Page files are listed relative to the metadata file. */
+		stream << "page " << file.substr(directory.size()) << " " << page.Width << " " << page.Height << std::endl;
+	}
+
+	for (const auto& entry : m_RegionIndex)
+	{
+		const AtlasRegion& region = m_Regions[entry.second];
+		stream << "region " << region.Page << " " << region.X << " " << region.Y << " "
+			<< region.Width << " " << region.Height << " " << entry.first << std::endl;
+	}
+
+	return (bool)stream;
+}
+
+bool TextureAtlas::Load(const std::string& path)
+{
+	std::ifstream stream(path);
+	if (!stream)
+	{
+		std::cout << "[Atlas Error] (" << path << "): could not open" << std::endl;
+		return false;
+	}
+
+	size_t slash = path.find_last_of("/\\");
+	std::string directory = slash != std::string::npos ? path.substr(0, slash + 1) : "";
+
+	m_Pending.clear();
+	m_Pages.clear();
+	m_Regions.clear();
+	m_RegionIndex.clear();
+
+	std::string line;
+	while (getline(stream, line))
+	{
+		std::stringstream ss(line);
+		std::string kind;
+		ss >> kind;
+
+		if (kind == "page")
+		{
+			std::string file;
+			int width, height, bpp;
+			ss >> file >> width >> height;
+
+			/* Flipped back to bottom first, stb_image turns the TGA top first while loading. */
+			stbi_set_flip_vertically_on_load_thread(1);
+			unsigned char* pixels = stbi_load((directory + file).c_str(), &width, &height, &bpp, 4);
+			if (!pixels)
+			{
+				std::cout << "[Atlas Error] (" << directory + file << "): " << stbi_failure_reason() << std::endl;
+				return false;
+			}
+
+			AddPage(width, height);
+			Page& page = m_Pages.back();
+			memcpy(page.Pixels.data(), pixels, page.Pixels.size());
+			/* The packing state isn't saved, new images go to new pages. */
+			page.FreeRects.clear();
+			stbi_image_free(pixels);
+		}
+		else if (kind == "region")
+		{
+			AtlasRegion region;
+			std::string name;
+			ss >> region.Page >> region.X >> region.Y >> region.Width >> region.Height;
+			getline(ss >> std::ws, name);
+
+			if (region.Page >= m_Pages.size())
+			{
+				std::cout << "[Atlas Error] (" << path << "): region " << name << " is on a missing page" << std::endl;
+				return false;
+			}
+
+			ComputeUVs(region);
+
+			m_RegionIndex[name] = (unsigned int)m_Regions.size();
+			m_Regions.push_back(region);
+		}
+	}
+
+	return true;
+}
+
+const AtlasRegion* TextureAtlas::Find(const std::string& name) const
+{
+	auto it = m_RegionIndex.find(name);
+	return it != m_RegionIndex.end() ? &m_Regions[it->second] : nullptr;
+}
+
+const Texture& TextureAtlas::GetPageTexture(unsigned int page) const
+{
+	ASSERT(page < m_Pages.size() && m_Pages[page].PageTexture);
+	return *m_Pages[page].PageTexture;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "glm/glm.hpp"
+
+class Texture;
+
+/* Where a packed image ended up. UVs are in the space of its page texture. */
+struct AtlasRegion
+{
+	unsigned int Page;
+	/* Pixel rectangle of the image inside the page, without the gutter. */
+	int X, Y, Width, Height;
+	glm::vec2 UVMin, UVMax;
+};
+
+/* Packs many images into a few large pages with MaxRects, so sprites from different files share a texture
+and can be drawn in one batch. Each image is surrounded by a gutter of its own edge pixels, and footprints
+are aligned to Alignment pixels so neither bilinear filtering nor the first mip levels mix neighbours.
+Pixel rows are stored bottom first like every other texture in the project.
+
+Works at runtime (Add, Build, Upload) and offline (Build then Save, later Load at runtime). */
+class TextureAtlas
+{
+public:
+	/* Footprints start and end on multiples of this, keeping log2(Alignment) mip levels clean. */
+	static const int Alignment = 4;
+
+private:
+	struct Rect
+	{
+		int X, Y, Width, Height;
+	};
+
+	struct Image
+	{
+		std::string Name;
+		int Width, Height;
+		std::vector<unsigned char> Pixels;
+	};
+
+	struct Page
+	{
+		int Width, Height;
+		std::vector<unsigned char> Pixels;
+		/* Maximal free rectangles, they overlap each other. */
+		std::vector<Rect> FreeRects;
+		std::unique_ptr<Texture> PageTexture;
+		/* Pixels changed since the last Upload. */
+		bool Dirty;
+	};
+
+	int m_PageSize;
+	int m_Padding;
+	std::vector<Image> m_Pending;
+	std::vector<Page> m_Pages;
+	std::vector<AtlasRegion> m_Regions;
+	std::unordered_map<std::string, unsigned int> m_RegionIndex;
+
+	void AddPage(int width, int height);
+	void ComputeUVs(AtlasRegion& region) const;
+	/* Best short side fit, returns false when width * height fits nowhere on page. */
+	static bool Insert(Page& page, int width, int height, Rect& result);
+	static void SplitFreeRects(Page& page, const Rect& used);
+	static void PruneFreeRects(Page& page);
+	/* Copies image into page at x, y and extrudes its edges into the gutter. */
+	void Blit(Page& page, const Image& image, int x, int y);
+
+public:
+	/* Padding is the gutter on each side of an image in pixels. */
+	TextureAtlas(int pageSize = 2048, int padding = 2);
+	~TextureAtlas();
+
+	/* Queues a file for the next Build, decoded with stb_image. */
+	bool Add(const std::string& name, const std::string& path, bool flipVertically = true);
+	/* Queues width * height RGBA8 pixels for the next Build. */
+	void Add(const std::string& name, const unsigned char* rgba, int width, int height);
+
+	/* Packs every queued image, largest first, opening pages as needed. Images already packed keep
+	their place, so the atlas can grow at runtime. Returns false if an image is larger than a page. */
+	bool Build();
+	/* Creates or refreshes the page textures, call on the render thread after Build or Load. */
+	void Upload();
+
+	/* Writes every page as <path without extension>_<page>.tga next to a text file at path listing the regions. */
+	bool Save(const std::string& path) const;
+	/* Reads what Save wrote, replacing the contents of the atlas. Loaded pages are treated as full. */
+	bool Load(const std::string& path);
+
+	/* nullptr when name was never packed. */
+	const AtlasRegion* Find(const std::string& name) const;
+
+	inline unsigned int GetPageCount() const { return (unsigned int)m_Pages.size(); }
+	/* Only valid after Upload. */
+	const Texture& GetPageTexture(unsigned int page) const;
+	inline const std::vector<AtlasRegion>& GetRegions() const { return m_Regions; }
+};
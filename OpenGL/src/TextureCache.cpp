@@ -0,0 +1,213 @@
+#include "TextureCache.h"
+#include "Texture.h"
+#include "MappedFile.h"
+#include "CompressedImage.h"
+#include "stb_image/stb_image.h"
+
+#include <iostream>
+
+namespace {
+
+	/* FNV-1a over the file contents. */
+	uint64_t HashContents(const unsigned char* data, size_t size)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= data[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	/* The same file loaded with a different flip is a different texture. */
+	std::string MakePathKey(const std::string& path, bool flipVertically)
+	{
+		return (flipVertically ? "1:" : "0:") + path;
+	}
+}
+
+TextureCache::Handle::Handle()
+	:m_Cache(nullptr)
+{
+}
+
+TextureCache::Handle::Handle(TextureCache* cache, std::shared_ptr<Entry> entry)
+	:m_Cache(cache), m_Entry(std::move(entry))
+{
+}
+
+Texture& TextureCache::Handle::Get() const
+{
+	ASSERT(m_Entry);
+	if (!m_Entry->Resident)
+	{
+		m_Cache->m_Stats.Misses++;
+		m_Cache->m_Stats.Reloads++;
+		m_Cache->LoadEntry(*m_Entry, MappedFile(m_Entry->Path));
+	}
+
+	m_Cache->Touch(*m_Entry);
+	return *m_Entry->Resident;
+}
+
+bool TextureCache::Handle::IsResident() const
+{
+	return m_Entry && m_Entry->Resident;
+}
+
+TextureCache::TextureCache(size_t budgetBytes)
+	:m_Budget(budgetBytes), m_Frame(0)
+{
+}
+
+TextureCache::~TextureCache()
+{
+	/* Entries release themselves through the cache, so none may be left. */
+	ASSERT(m_LRU.empty() && m_ByPath.empty());
+}
+
+std::shared_ptr<TextureCache::Entry> TextureCache::CreateEntry(const std::string& path, bool flipVertically)
+{
+	std::shared_ptr<Entry> entry(new Entry(), [this](Entry* released)
+	{
+		Release(*released);
+		delete released;
+	});
+	entry->Path = path;
+	entry->FlipVertically = flipVertically;
+	entry->ContentHash = 0;
+	entry->Bytes = 0;
+	entry->LastUsedFrame = m_Frame;
+	return entry;
+}
+
+TextureCache::Handle TextureCache::Load(const std::string& path, bool flipVertically)
+{
+	std::string key = MakePathKey(path, flipVertically);
+	auto byPath = m_ByPath.find(key);
+	if (byPath != m_ByPath.end())
+	{
+		m_Stats.Hits++;
+		return Handle(this, byPath->second.lock());
+	}
+
+	std::shared_ptr<Entry> entry = CreateEntry(path, flipVertically);
+	MappedFile file(path);
+	if (file.IsOpen())
+	{
+		/* A copy of a file under another name shares the texture that is already there, checked before decoding.
+		Flipped and unflipped decodes of the same contents are different textures. */
+		entry->ContentHash = HashContents(file.GetData(), file.GetSize()) ^ (flipVertically ? 0 : 0x9e3779b97f4a7c15ull);
+		auto byContent = m_ByContent.find(entry->ContentHash);
+		if (byContent != m_ByContent.end())
+		{
+			std::shared_ptr<Entry> shared = byContent->second.lock();
+			shared->PathKeys.push_back(key);
+			m_ByPath[key] = shared;
+			m_Stats.Hits++;
+			return Handle(this, shared);
+		}
+
+		entry->PathKeys.push_back(key);
+		m_ByPath[key] = entry;
+		m_ByContent[entry->ContentHash] = entry;
+	}
+
+	/* Unreadable files are not found by path, so the next Load tries the file again. */
+	m_Stats.Misses++;
+	LoadEntry(*entry, file);
+	return Handle(this, entry);
+}
+
+void TextureCache::Release(Entry& entry)
+{
+	Evict(entry);
+
+	/* Entries are only reachable through their keys while a handle exists, so expired keys are always this entry's. */
+	for (const std::string& key : entry.PathKeys)
+		m_ByPath.erase(key);
+	if (!entry.PathKeys.empty())
+		m_ByContent.erase(entry.ContentHash);
+}
+
+void TextureCache::LoadEntry(Entry& entry, const MappedFile& file)
+{
+	if (!file.IsOpen())
+	{
+		std::cout << "[Texture Error] (" << entry.Path << "): could not open file" << std::endl;
+	}
+	else if (IsCompressedImagePath(entry.Path))
+	{
+		CompressedImage image;
+		std::string error;
+		if (ParseCompressedImage(file.GetData(), file.GetSize(), image, error))
+		{
+			entry.Resident = std::make_shared<Texture>();
+			entry.Resident->SetCompressedData(image);
+		}
+		else
+			std::cout << "[Texture Error] (" << entry.Path << "): " << error << std::endl;
+	}
+	else
+	{
+		/* Decoded straight from the mapping, the file is only read once for hashing and decoding. */
+		int width, height, bpp;
+		stbi_set_flip_vertically_on_load_thread(entry.FlipVertically);
+		unsigned char* pixels = stbi_load_from_memory(file.GetData(), (int)file.GetSize(), &width, &height, &bpp, 4);
+		if (pixels)
+		{
+			entry.Resident = std::make_shared<Texture>(width, height, pixels);
+			stbi_image_free(pixels);
+		}
+		else
+		{
+			std::cout << "[Texture Error] (" << entry.Path << "): " << stbi_failure_reason() << std::endl;
+		}
+	}
+
+	/* Failed files all show the same checkerboard, it is not counted against the budget. */
+	if (entry.Resident)
+		entry.Bytes = entry.Resident->GetMemorySize();
+	else
+	{
+		if (!m_Placeholder)
+			m_Placeholder = std::make_shared<Texture>();
+		entry.Resident = m_Placeholder;
+		entry.Bytes = 0;
+	}
+	m_Stats.ResidentBytes += entry.Bytes;
+	m_Stats.ResidentCount++;
+	m_LRU.push_front(&entry);
+	entry.LRUPosition = m_LRU.begin();
+}
+
+void TextureCache::Touch(Entry& entry)
+{
+	entry.LastUsedFrame = m_Frame;
+	if (entry.LRUPosition != m_LRU.begin())
+		m_LRU.splice(m_LRU.begin(), m_LRU, entry.LRUPosition);
+}
+
+void TextureCache::Evict(Entry& entry)
+{
+	if (!entry.Resident)
+		return;
+
+	m_LRU.erase(entry.LRUPosition);
+	m_Stats.ResidentBytes -= entry.Bytes;
+	m_Stats.ResidentCount--;
+	entry.Resident.reset();
+}
+
+void TextureCache::EndFrame()
+{
+	/* Anything used this frame may still be referenced by queued draws. */
+	while (m_Stats.ResidentBytes > m_Budget && !m_LRU.empty() && m_LRU.back()->LastUsedFrame < m_Frame)
+	{
+		Evict(*m_LRU.back());
+		m_Stats.Evictions++;
+	}
+
+	m_Frame++;
+}
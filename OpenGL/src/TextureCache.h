@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Texture;
+class MappedFile;
+
+/* Shares textures between everyone who loads the same file, by path and by content hash, and keeps their
+estimated GPU memory under a budget. When the budget is exceeded EndFrame evicts the least recently used
+textures, a handle to an evicted texture reloads it the next time it is used. The cache only keeps weak
+references, a texture is freed as soon as its last handle is gone. Handles must not outlive the cache. */
+class TextureCache
+{
+public:
+	struct Stats
+	{
+		unsigned int Hits = 0;
+		unsigned int Misses = 0;
+		unsigned int Evictions = 0;
+		/* Evicted textures loaded again, also counted as misses. */
+		unsigned int Reloads = 0;
+		unsigned int ResidentCount = 0;
+		size_t ResidentBytes = 0;
+	};
+
+private:
+	struct Entry
+	{
+		std::string Path;
+		bool FlipVertically;
+		uint64_t ContentHash;
+		/* Keys in m_ByPath that lead here, empty when the file could not be opened. */
+		std::vector<std::string> PathKeys;
+		/* nullptr while evicted, the shared placeholder when the file could not be loaded. */
+		std::shared_ptr<Texture> Resident;
+		size_t Bytes;
+		/* Frame of the last Get, textures used in the current frame are never evicted. */
+		uint64_t LastUsedFrame;
+		/* Position in m_LRU while resident. */
+		std::list<Entry*>::iterator LRUPosition;
+	};
+
+public:
+	/* Ref counted reference to a cached texture, cheap to copy. */
+	class Handle
+	{
+	private:
+		TextureCache* m_Cache;
+		std::shared_ptr<Entry> m_Entry;
+
+	public:
+		Handle();
+		Handle(TextureCache* cache, std::shared_ptr<Entry> entry);
+
+		/* Marks the texture as used this frame, reloading it first if it was evicted. */
+		Texture& Get() const;
+		inline Texture* operator->() const { return &Get(); }
+
+		inline bool IsValid() const { return m_Entry != nullptr; }
+		bool IsResident() const;
+	};
+
+private:
+	size_t m_Budget;
+	uint64_t m_Frame;
+	std::unordered_map<std::string, std::weak_ptr<Entry>> m_ByPath;
+	std::unordered_map<uint64_t, std::weak_ptr<Entry>> m_ByContent;
+	/* Given to every file that fails to load, created on the first failure. */
+	std::shared_ptr<Texture> m_Placeholder;
+	/* Resident entries, most recently used at the front. */
+	std::list<Entry*> m_LRU;
+	Stats m_Stats;
+
+	/* Decodes and uploads file, or makes a placeholder when it could not be opened. */
+	void LoadEntry(Entry& entry, const MappedFile& file);
+	void Touch(Entry& entry);
+	void Evict(Entry& entry);
+	/* Called when the last handle to entry is gone, frees its texture and forgets its keys. */
+	void Release(Entry& entry);
+	std::shared_ptr<Entry> CreateEntry(const std::string& path, bool flipVertically);
+
+public:
+	/* budgetBytes is the estimated GPU memory the cache may keep resident. */
+	TextureCache(size_t budgetBytes);
+	~TextureCache();
+
+	TextureCache(const TextureCache&) = delete;
+	TextureCache& operator=(const TextureCache&) = delete;
+
+	/* Returns the cached texture for path, loading it synchronously on a miss. A file with the same
+	contents as one already cached shares its texture. */
+	Handle Load(const std::string& path, bool flipVertically = true);
+
+	/* Evicts least recently used textures until the resident size fits the budget, then starts a new frame.
+	Call once per frame after the last draw, textures used since the previous call are kept. */
+	void EndFrame();
+
+	inline void SetBudget(size_t budgetBytes) { m_Budget = budgetBytes; }
+	inline size_t GetBudget() const { return m_Budget; }
+	inline const Stats& GetStats() const { return m_Stats; }
+	inline void ResetStats() { m_Stats.Hits = m_Stats.Misses = m_Stats.Evictions = m_Stats.Reloads = 0; }
+};
@@ -0,0 +1,192 @@
+#include "TextureLoader.h"
+#include "Texture.h"
+#include "Renderer.h"
+#include "GLState.h"
+#include "BufferUpdate.h"
+#include "CompressedImage.h"
+#include "MipChain.h"
+#include "stb_image/stb_image.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+TextureLoader::TextureLoader(unsigned int workerCount)
+	:m_Stopping(false), m_PixelBuffer(0)
+{
+	if (workerCount == 0)
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	/* Not through GL_PIXEL_UNPACK_BUFFER, a buffer left there would redirect every texture upload. */
+	m_PixelBuffer = CreateBuffer(GL_COPY_WRITE_BUFFER);
+
+	for (unsigned int i = 0; i < workerCount; i++)
+		m_Workers.emplace_back(&TextureLoader::WorkerLoop, this);
+}
+
+TextureLoader::~TextureLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+	}
+	m_Condition.notify_all();
+
+	for (std::thread& worker : m_Workers)
+		worker.join();
+
+	GLState::ForgetBuffer(m_PixelBuffer);
+	GLCall(glDeleteBuffers(1, &m_PixelBuffer));
+}
+
+std::shared_ptr<Texture> TextureLoader::Load(const std::string& path, bool flipVertically)
+{
+	/* Block compressed files upload straight from a file mapping, there is nothing to decode. */
+	if (IsCompressedImagePath(path))
+		return std::make_shared<Texture>(path, flipVertically);
+
+	std::shared_ptr<Texture> texture = std::make_shared<Texture>();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Requests.push_back({ path, flipVertically, texture });
+	}
+	m_Condition.notify_one();
+
+	m_Stats.Pending++;
+	return texture;
+}
+
+void TextureLoader::WorkerLoop()
+{
+	while (true)
+	{
+		Request request;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this] { return m_Stopping || !m_Requests.empty(); });
+
+			if (m_Stopping)
+				return;
+
+			request = std::move(m_Requests.front());
+			m_Requests.pop_front();
+		}
+
+		DecodedImage image = { request.Path, request.Target, {}, 0, 0, 0, nullptr };
+
+		/* Skip the decode if the texture was released while the request waited. */
+		if (!request.Target.expired())
+		{
+			/* The flip flag is thread local, workers don't see each other's setting. */
+			int bpp;
+			stbi_set_flip_vertically_on_load_thread(request.FlipVertically);
+			unsigned char* pixels = stbi_load(request.Path.c_str(), &image.Width, &image.Height, &bpp, 4);
+
+			if (pixels)
+			{
+				/* Mips are filtered here so the render thread only has to copy them. */
+				image.MipCount = BuildMipChain(pixels, image.Width, image.Height, image.Pixels);
+				stbi_image_free(pixels);
+			}
+			else
+				image.Error = stbi_failure_reason();
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Decoded.push_back(std::move(image));
+	}
+}
+
+void TextureLoader::Update(double budgetMilliseconds)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	while (true)
+	{
+		DecodedImage image;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (m_Decoded.empty())
+				return;
+
+			image = std::move(m_Decoded.front());
+			m_Decoded.pop_front();
+		}
+
+		m_Stats.Pending--;
+
+		/* Locked on the render thread, so if this is the last reference the texture is deleted here. */
+		std::shared_ptr<Texture> texture = image.Target.lock();
+		if (texture && !image.Pixels.empty())
+		{
+			if (Upload(*texture, image))
+			{
+				m_Stats.Uploaded++;
+			}
+			else
+			{
+				std::cout << "[Texture Error] (" << image.Path << "): pixel buffer could not be written" << std::endl;
+				m_Stats.Failed++;
+			}
+		}
+		else if (texture)
+		{
+			std::cout << "[Texture Error] (" << image.Path << "): " << image.Error << std::endl;
+			m_Stats.Failed++;
+		}
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		if (elapsed.count() >= budgetMilliseconds)
+			return;
+	}
+}
+
+bool TextureLoader::Upload(Texture& texture, const DecodedImage& image)
+{
+	unsigned int size = (unsigned int)image.Pixels.size();
+
+	/* Orphan the previous upload instead of waiting for the driver to finish reading it. */
+	SetBufferData(m_PixelBuffer, GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+
+	void* mapped;
+	bool directStateAccess = GLState::HasDirectStateAccess();
+	if (directStateAccess)
+	{
+		GLCall(mapped = glMapNamedBufferRange(m_PixelBuffer, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	}
+	else
+	{
+		GLCall(mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	}
+	bool written = false;
+	if (mapped)
+	{
+		memcpy(mapped, image.Pixels.data(), size);
+		/* False when the store was lost while mapped, on a display mode change for example. */
+		GLboolean intact;
+		if (directStateAccess)
+		{
+			GLCall(intact = glUnmapNamedBuffer(m_PixelBuffer));
+		}
+		else
+		{
+			GLCall(intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER));
+		}
+		written = intact == GL_TRUE;
+	}
+
+	if (written)
+	{
+		/* With the unpack buffer bound the pointer is an offset into it. */
+		GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, m_PixelBuffer);
+		texture.SetMipData(image.Width, image.Height, image.MipCount, nullptr);
+	}
+
+	/* Left bound, every later glTexImage2D would read from the buffer instead of client memory. */
+	GLState::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	return written;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class Texture;
+
+/* Decodes images and builds their mip chains on a pool of worker threads, then uploads them on the render thread.
+Load hands out a placeholder texture right away, Update swaps in the real image once it is decoded.
+Workers never touch GL and only hold weak references, so textures are always created and destroyed
+on the thread that owns the context. */
+class TextureLoader
+{
+public:
+	struct Stats
+	{
+		/* Requested but not uploaded yet. */
+		unsigned int Pending = 0;
+		unsigned int Uploaded = 0;
+		unsigned int Failed = 0;
+	};
+
+private:
+	struct Request
+	{
+		std::string Path;
+		bool FlipVertically;
+		std::weak_ptr<Texture> Target;
+	};
+
+	struct DecodedImage
+	{
+		std::string Path;
+		std::weak_ptr<Texture> Target;
+		/* Every mip level packed one after the other, empty when decoding failed. */
+		std::vector<unsigned char> Pixels;
+		int Width, Height, MipCount;
+		/* stb_image keeps its failure reason per thread, so it is captured on the worker. */
+		const char* Error;
+	};
+
+	std::vector<std::thread> m_Workers;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	std::deque<Request> m_Requests;
+	std::deque<DecodedImage> m_Decoded;
+	bool m_Stopping;
+
+	/* Pixel unpack buffer, orphaned for every upload so the driver can copy from it asynchronously. */
+	unsigned int m_PixelBuffer;
+	Stats m_Stats;
+
+	void WorkerLoop();
+	/* False when the pixel buffer could not be mapped or lost its contents, the texture keeps its placeholder. */
+	bool Upload(Texture& texture, const DecodedImage& image);
+
+public:
+	/* 0 picks one worker less than the number of hardware threads, leaving a core for rendering. */
+	TextureLoader(unsigned int workerCount = 0);
+	~TextureLoader();
+
+	/* Queues path for decoding and returns the placeholder that will receive the image.
+	Dropping the returned texture before it is ready cancels the upload. */
+	std::shared_ptr<Texture> Load(const std::string& path, bool flipVertically = true);
+
+	/* Uploads decoded images until budgetMilliseconds is used up, at least one per call so loading
+	always makes progress. Call once per frame on the render thread. */
+	void Update(double budgetMilliseconds);
+
+	inline const Stats& GetStats() const { return m_Stats; }
+};
@@ -0,0 +1,65 @@
+#include "UniformBuffer.h"
+#include "Renderer.h"
+#include "GLState.h"
+
+UniformBuffer::UniformBuffer(unsigned int size)
+	:m_RenderID(0), m_Size(size), m_Allocated(0), m_OffsetAlignment(256)
+{
+	int alignment = 0;
+	GLCall(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+	if (alignment > 0)
+		m_OffsetAlignment = alignment;
+
+	if (GLState::HasDirectStateAccess())
+	{
+		/* The size never changes, so the storage can be immutable. */
+		GLCall(glCreateBuffers(1, &m_RenderID));
+		GLCall(glNamedBufferStorage(m_RenderID, size, nullptr, GL_DYNAMIC_STORAGE_BIT));
+	}
+	else
+	{
+		GLCall(glGenBuffers(1, &m_RenderID));
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, m_RenderID);
+		GLCall(glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW));
+	}
+}
+
+UniformBuffer::~UniformBuffer()
+{
+	GLState::ForgetBuffer(m_RenderID);
+	GLCall(glDeleteBuffers(1, &m_RenderID));
+}
+
+void UniformBuffer::SetData(const void* data, unsigned int size, unsigned int offset)
+{
+	ASSERT(offset + size <= m_Size);
+
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glNamedBufferSubData(m_RenderID, offset, size, data));
+	}
+	else
+	{
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, m_RenderID);
+		GLCall(glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data));
+	}
+}
+
+unsigned int UniformBuffer::Allocate(unsigned int size)
+{
+	unsigned int offset = (m_Allocated + m_OffsetAlignment - 1) / m_OffsetAlignment * m_OffsetAlignment;
+	ASSERT(offset + size <= m_Size);
+
+	m_Allocated = offset + size;
+	return offset;
+}
+
+void UniformBuffer::Bind(unsigned int binding) const
+{
+	GLState::BindBufferRange(GL_UNIFORM_BUFFER, binding, m_RenderID, 0, m_Size);
+}
+
+void UniformBuffer::BindRange(unsigned int binding, unsigned int offset, unsigned int size) const
+{
+	GLState::BindBufferRange(GL_UNIFORM_BUFFER, binding, m_RenderID, offset, size);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <GL/glew.h>
+
+#include "glm/glm.hpp"
+
+/* Fixed binding points shared by every shader, see the layout(binding = n) qualifiers in the shaders. */
+struct UniformBinding
+{
+	/* Per frame camera data, u_ViewProjection. */
+	static const unsigned int Camera = 0;
+	/* Per material data, suballocated from one buffer and selected with BindRange. */
+	static const unsigned int Material = 1;
+};
+
+/* Same for shader storage blocks, layout(std430, binding = n). */
+struct StorageBinding
+{
+	/* Per draw model matrices written by Renderer::FlushIndirect. */
+	static const unsigned int DrawData = 0;
+};
+
+/* Size and base alignment of a type inside a std140 block. */
+template<typename T>
+struct Std140Type;
+
+template<> struct Std140Type<float>		{ static const unsigned int Size = 4;  static const unsigned int Alignment = 4; };
+template<> struct Std140Type<int>		{ static const unsigned int Size = 4;  static const unsigned int Alignment = 4; };
+template<> struct Std140Type<glm::vec2>	{ static const unsigned int Size = 8;  static const unsigned int Alignment = 8; };
+template<> struct Std140Type<glm::vec3>	{ static const unsigned int Size = 12; static const unsigned int Alignment = 16; };
+template<> struct Std140Type<glm::vec4>	{ static const unsigned int Size = 16; static const unsigned int Alignment = 16; };
+/* Matrices are laid out as arrays of vec4 columns. */
+template<> struct Std140Type<glm::mat4>	{ static const unsigned int Size = 64; static const unsigned int Alignment = 16; };
+
+/* Computes std140 member offsets in declaration order, push members the way the GLSL block declares them. */
+class Std140Layout
+{
+private:
+	unsigned int m_Size;
+
+	static unsigned int Align(unsigned int value, unsigned int alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+public:
+	Std140Layout()
+		:m_Size(0) {}
+
+	/* Returns the offset of the member. Arrays round every element up to a vec4. */
+	template<typename T>
+	unsigned int Push(unsigned int count = 1)
+	{
+		unsigned int alignment = Std140Type<T>::Alignment;
+		unsigned int stride = Std140Type<T>::Size;
+		if (count > 1)
+		{
+			alignment = Align(alignment, 16);
+			stride = Align(stride, 16);
+		}
+
+		unsigned int offset = Align(m_Size, alignment);
+		m_Size = offset + stride * count;
+		return offset;
+	}
+
+	/* Block size as the driver reports it, padded to a vec4. */
+	inline unsigned int GetSize() const { return Align(m_Size, 16); }
+};
+
+/* Uniform buffer object. Shared data is uploaded once and stays bound to its binding point across
+program switches, several blocks can be suballocated from one buffer with Allocate and BindRange. */
+class UniformBuffer
+{
+private:
+	/* Id for openGl sate machine. */
+	unsigned int m_RenderID;
+	unsigned int m_Size;
+	/* Bytes handed out by Allocate so far. */
+	unsigned int m_Allocated;
+	/* GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, BindRange offsets must be multiples of it. */
+	unsigned int m_OffsetAlignment;
+
+public:
+	/* Size is in bytes. */
+	UniformBuffer(unsigned int size);
+	~UniformBuffer();
+
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+	void SetData(const void* data, unsigned int size, unsigned int offset = 0);
+
+	/* Reserves size bytes for one block and returns its offset, ASSERTs when the buffer is full. */
+	unsigned int Allocate(unsigned int size);
+	/* Releases every allocation at once. */
+	inline void Reset() { m_Allocated = 0; }
+
+	/* Binds the whole buffer to binding. */
+	void Bind(unsigned int binding) const;
+	void BindRange(unsigned int binding, unsigned int offset, unsigned int size) const;
+
+	inline unsigned int GetSize() const { return m_Size; }
+};
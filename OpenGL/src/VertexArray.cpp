@@ -1,41 +1,241 @@
 #include "VertexArray.h"
 #include "Renderer.h"
-#include "VertexBufferLayout.h"
+#include "GLState.h"
+
+/* Byte offset of one column of element, only matrices have more than one. Packed formats have no
+per component size, they never get past column 0. */
+static unsigned int GetColumnOffset(const VertexBufferElement& element, unsigned int column)
+{
+	if (column == 0)
+		return element.offset;
+	return element.offset + column * element.count * VertexBufferElement::GetSizeOfType(element.type);
+}
 
 VertexArray::VertexArray()
+	:m_AttribCount(0), m_BindingCount(0)
 {
 	/* Create vertex arrray and passes ID to m_RenderID. */
-	GLCall(glGenVertexArrays(1, &m_RendererID));
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glCreateVertexArrays(1, &m_RendererID));
+	}
+	else
+	{
+		GLCall(glGenVertexArrays(1, &m_RendererID));
+	}
 }
 
 VertexArray::~VertexArray()
 {
+	Release();
+}
+
+VertexArray::VertexArray(VertexArray&& other) noexcept
+	:m_RendererID(other.m_RendererID), m_AttribCount(other.m_AttribCount), m_BindingCount(other.m_BindingCount)
+{
+	other.m_RendererID = 0;
+	other.m_AttribCount = 0;
+	other.m_BindingCount = 0;
+}
+
+VertexArray& VertexArray::operator=(VertexArray&& other) noexcept
+{
+	if (this != &other)
+	{
+		Release();
+		m_RendererID = other.m_RendererID;
+		m_AttribCount = other.m_AttribCount;
+		m_BindingCount = other.m_BindingCount;
+		other.m_RendererID = 0;
+		other.m_AttribCount = 0;
+		other.m_BindingCount = 0;
+	}
+	return *this;
+}
+
+void VertexArray::Release()
+{
+	if (m_RendererID == 0)
+		return;
+
+	GLState::ForgetVertexArray(m_RendererID);
 	GLCall(glDeleteVertexArrays(1, &m_RendererID));
+	m_RendererID = 0;
 }
 
-void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout)
+void VertexArray::AddBuffer(const VertexBuffer& vb, const VertexLayoutView& layout)
 {
+	if (GLState::HasDirectStateAccess())
+	{
+		SetupBindings(vb.GetRendererID(), layout);
+		return;
+	}
+
+	Bind();
+	vb.Bind();
+	SetupAttributes(layout);
+}
+
+void VertexArray::AddBuffer(const StreamingVertexBuffer& vb, const VertexLayoutView& layout)
+{
+	if (GLState::HasDirectStateAccess())
+	{
+		SetupBindings(vb.GetRendererID(), layout);
+		return;
+	}
+
 	Bind();
 	vb.Bind();
-	const auto& elements = layout.GetElements();
-	unsigned int offset = 0;
-	for( unsigned int i = 0; i < elements.size(); i++ )
+	SetupAttributes(layout);
+}
+
+void VertexArray::SetupAttributes(const VertexLayoutView& layout)
+{
+	for( unsigned int i = 0; i < layout.Count; i++ )
 	{
-		const auto& element = elements[i];
-		GLCall(glEnableVertexAttribArray(i));
-		GLCall(glVertexAttribPointer(i, element.count, element.type, 
-			element.normalized, layout.GetStride(), (const void*)offset));
-		offset += element.count * VertexBufferElement::GetSizeOfType(element.type);
+		const auto& element = layout.Elements[i];
+		for (unsigned int column = 0; column < element.locations; column++)
+		{
+			unsigned int location = m_AttribCount++;
+			uintptr_t offset = GetColumnOffset(element, column);
+
+			GLCall(glEnableVertexAttribArray(location));
+			if (element.integer)
+			{
+				GLCall(glVertexAttribIPointer(location, element.count, element.type, layout.Stride, (const void*)offset));
+			}
+			else
+			{
+				GLCall(glVertexAttribPointer(location, element.count, element.type, 
+					element.normalized, layout.Stride, (const void*)offset));
+			}
+			if (element.divisor)
+			{
+				GLCall(glVertexAttribDivisor(location, element.divisor));
+			}
+		}
 	}
-	
+}
+
+void VertexArray::SetupBindings(unsigned int buffer, const VertexLayoutView& layout)
+{
+	unsigned int firstBinding = m_BindingCount;
+	/* Divisors of the bindings made so far for this buffer, indexed from firstBinding. */
+	unsigned int divisors[MaxBindings];
+	for (unsigned int i = 0; i < layout.Count; i++)
+	{
+		const auto& element = layout.Elements[i];
+		unsigned int binding = firstBinding;
+		while (binding < m_BindingCount && divisors[binding - firstBinding] != element.divisor)
+			binding++;
+
+		if (binding == m_BindingCount)
+		{
+			ASSERT(binding < MaxBindings);
+			divisors[binding - firstBinding] = element.divisor;
+			m_BindingCount++;
+			GLCall(glVertexArrayVertexBuffer(m_RendererID, binding, buffer, 0, layout.Stride));
+			GLCall(glVertexArrayBindingDivisor(m_RendererID, binding, element.divisor));
+		}
+
+		SetElementFormat(element, binding);
+	}
+}
+
+void VertexArray::SetElementFormat(const VertexBufferElement& element, unsigned int binding)
+{
+	for (unsigned int column = 0; column < element.locations; column++)
+	{
+		unsigned int location = m_AttribCount++;
+		GLCall(glEnableVertexArrayAttrib(m_RendererID, location));
+		if (element.integer)
+		{
+			GLCall(glVertexArrayAttribIFormat(m_RendererID, location, element.count, element.type, GetColumnOffset(element, column)));
+		}
+		else
+		{
+			GLCall(glVertexArrayAttribFormat(m_RendererID, location, element.count, element.type,
+				element.normalized, GetColumnOffset(element, column)));
+		}
+		GLCall(glVertexArrayAttribBinding(m_RendererID, location, binding));
+	}
+}
+
+void VertexArray::SetFormat(const VertexLayoutView& layout, unsigned int binding)
+{
+	if (binding >= m_BindingCount)
+		m_BindingCount = binding + 1;
+
+	if (GLState::HasDirectStateAccess())
+	{
+		for (unsigned int i = 0; i < layout.Count; i++)
+			SetElementFormat(layout.Elements[i], binding);
+		if (layout.Count > 0)
+		{
+			GLCall(glVertexArrayBindingDivisor(m_RendererID, binding, layout.Elements[0].divisor));
+		}
+		return;
+	}
+
+	Bind();
+	for (unsigned int i = 0; i < layout.Count; i++)
+	{
+		const auto& element = layout.Elements[i];
+		for (unsigned int column = 0; column < element.locations; column++)
+		{
+			unsigned int location = m_AttribCount++;
+			unsigned int offset = GetColumnOffset(element, column);
+
+			GLCall(glEnableVertexAttribArray(location));
+			if (element.integer)
+			{
+				GLCall(glVertexAttribIFormat(location, element.count, element.type, offset));
+			}
+			else
+			{
+				GLCall(glVertexAttribFormat(location, element.count, element.type, element.normalized, offset));
+			}
+			GLCall(glVertexAttribBinding(location, binding));
+		}
+	}
+	if (layout.Count > 0)
+	{
+		GLCall(glVertexBindingDivisor(binding, layout.Elements[0].divisor));
+	}
+}
+
+void VertexArray::BindVertexBuffer(const VertexBuffer& vb, unsigned int stride, unsigned int binding)
+{
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glVertexArrayVertexBuffer(m_RendererID, binding, vb.GetRendererID(), 0, stride));
+		return;
+	}
+
+	Bind();
+	GLCall(glBindVertexBuffer(binding, vb.GetRendererID(), 0, stride));
+}
+
+void VertexArray::SetIndexBuffer(const IndexBuffer& ib)
+{
+	if (GLState::HasDirectStateAccess())
+	{
+		GLCall(glVertexArrayElementBuffer(m_RendererID, ib.GetRendererID()));
+		/* The cached element binding is stale if this vertex array is the bound one. */
+		GLState::ForgetVertexArray(m_RendererID);
+		return;
+	}
+
+	Bind();
+	ib.Bind();
 }
 
 void VertexArray::Bind() const
 {
-	GLCall(glBindVertexArray(m_RendererID));
+	GLState::BindVertexArray(m_RendererID);
 }
 
 void VertexArray::Unbind() const
 {
-	GLCall(glBindVertexArray(0));
+	GLState::BindVertexArray(0);
 }
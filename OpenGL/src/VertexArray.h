@@ -2,20 +2,57 @@
 
 #include <GL/glew.h>
 #include "VertexBuffer.h"
-
-class VertexBufferLayout;
+#include "IndexBuffer.h"
+#include "StreamingVertexBuffer.h"
+#include "VertexBufferLayout.h"
 
 class VertexArray
 {
 private:
+	/* 0 once moved from. */
 	unsigned int m_RendererID;
+	/* Next free attribute location, so several buffers can feed one vertex array. */
+	unsigned int m_AttribCount;
+	/* Next free vertex buffer binding, only used with direct state access. */
+	unsigned int m_BindingCount;
+
+	/* The smallest GL_MAX_VERTEX_ATTRIB_BINDINGS an implementation may have. */
+	static const unsigned int MaxBindings = 16;
+
+	/* Points the layout's attributes at the currently bound GL_ARRAY_BUFFER. */
+	void SetupAttributes(const VertexLayoutView& layout);
+	/* Direct state access version, the buffer goes behind new bindings without binding anything.
+	Divisors belong to a binding there, so each divisor in layout gets its own. */
+	void SetupBindings(unsigned int buffer, const VertexLayoutView& layout);
+	/* Formats element's attribute locations by name and points them at binding. */
+	void SetElementFormat(const VertexBufferElement& element, unsigned int binding);
+	void Release();
 
 public:
 	VertexArray();
 	~VertexArray();
 
-	void AddBuffer(const VertexBuffer& vb, const VertexBufferLayout& layout);
+	/* Move only, a copy would delete the same GL vertex array twice. */
+	VertexArray(const VertexArray&) = delete;
+	VertexArray& operator=(const VertexArray&) = delete;
+	VertexArray(VertexArray&& other) noexcept;
+	VertexArray& operator=(VertexArray&& other) noexcept;
+
+	/* Attributes continue at the location after the previous buffer's, per-instance data goes in its own buffer. */
+	void AddBuffer(const VertexBuffer& vb, const VertexLayoutView& layout);
+	/* Attributes start at the beginning of the buffer, draw with a base vertex to pick a frame's region. */
+	void AddBuffer(const StreamingVertexBuffer& vb, const VertexLayoutView& layout);
+
+	/* ARB_vertex_attrib_binding: the attribute formats are set once and read from whatever buffer
+	BindVertexBuffer puts behind binding, so one vertex array serves every buffer with this layout.
+	The binding's divisor comes from the first element. */
+	void SetFormat(const VertexLayoutView& layout, unsigned int binding = 0);
+	void BindVertexBuffer(const VertexBuffer& vb, unsigned int stride, unsigned int binding = 0);
+	/* Makes ib this vertex array's element buffer, binding the vertex array afterwards binds ib too. */
+	void SetIndexBuffer(const IndexBuffer& ib);
 
 	void Bind() const;
 	void Unbind() const;
+
+	inline unsigned int GetRendererID() const { return m_RendererID; }
 };
\ No newline at end of file
@@ -0,0 +1,199 @@
+#include "VertexArrayCache.h"
+#include "Renderer.h"
+#include "IndexBuffer.h"
+#include "GLState.h"
+
+#include <algorithm>
+
+namespace
+{
+	const uint64_t FnvOffset = 14695981039346656037ull;
+	const uint64_t FnvPrime = 1099511628211ull;
+
+	/* Every constructed cache, so buffers can be forgotten wherever they are referenced. */
+	std::vector<VertexArrayCache*> s_Caches;
+
+	void HashValue(uint64_t& hash, uint64_t value)
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			hash ^= (value >> (i * 8)) & 0xff;
+			hash *= FnvPrime;
+		}
+	}
+}
+
+size_t VertexArrayCache::KeyHash::operator()(const Key& key) const
+{
+	uint64_t hash = FnvOffset;
+	HashValue(hash, (uint64_t)(uintptr_t)key.Layout);
+	HashValue(hash, key.VertexBuffer);
+	HashValue(hash, key.IndexBuffer);
+	return (size_t)hash;
+}
+
+uint64_t VertexArrayCache::HashLayout(const VertexLayoutView& layout)
+{
+	/* Field by field, the struct has padding bytes. */
+	uint64_t hash = FnvOffset;
+	HashValue(hash, layout.Stride);
+	for (unsigned int i = 0; i < layout.Count; i++)
+	{
+		const VertexBufferElement& element = layout.Elements[i];
+		HashValue(hash, element.count);
+		HashValue(hash, element.type);
+		HashValue(hash, element.normalized);
+		HashValue(hash, element.divisor);
+		HashValue(hash, element.offset);
+		HashValue(hash, element.locations);
+		HashValue(hash, element.integer);
+	}
+	return hash;
+}
+
+bool VertexArrayCache::IsSameLayout(const StoredLayout& stored, const VertexLayoutView& layout)
+{
+	if (stored.Stride != layout.Stride || stored.Elements.size() != layout.Count)
+		return false;
+
+	for (unsigned int i = 0; i < layout.Count; i++)
+	{
+		const VertexBufferElement& a = stored.Elements[i];
+		const VertexBufferElement& b = layout.Elements[i];
+		if (a.count != b.count || a.type != b.type || a.normalized != b.normalized || a.divisor != b.divisor
+			|| a.offset != b.offset || a.locations != b.locations || a.integer != b.integer)
+			return false;
+	}
+	return true;
+}
+
+const VertexArrayCache::StoredLayout* VertexArrayCache::FindLayout(const VertexLayoutView& layout)
+{
+	uint64_t hash = HashLayout(layout);
+	auto range = m_Layouts.equal_range(hash);
+	for (auto it = range.first; it != range.second; it++)
+	{
+		if (IsSameLayout(*it->second, layout))
+			return it->second.get();
+	}
+
+	std::unique_ptr<StoredLayout> stored = std::make_unique<StoredLayout>();
+	stored->Stride = layout.Stride;
+	stored->Elements.assign(layout.Elements, layout.Elements + layout.Count);
+	return m_Layouts.emplace(hash, std::move(stored))->second.get();
+}
+
+bool VertexArrayCache::CanShare(const VertexLayoutView& layout)
+{
+	for (unsigned int i = 1; i < layout.Count; i++)
+	{
+		if (layout.Elements[i].divisor != layout.Elements[0].divisor)
+			return false;
+	}
+	return true;
+}
+
+VertexArrayCache::VertexArrayCache(bool useAttribBinding)
+	:m_UseAttribBinding(useAttribBinding && (GLEW_VERSION_4_3 || GLEW_ARB_vertex_attrib_binding))
+{
+	s_Caches.push_back(this);
+}
+
+VertexArrayCache::~VertexArrayCache()
+{
+	s_Caches.erase(std::find(s_Caches.begin(), s_Caches.end(), this));
+}
+
+const VertexArray& VertexArrayCache::Get(const VertexBuffer& vb, const VertexLayoutView& layout, const IndexBuffer& ib)
+{
+	Key key = { FindLayout(layout), vb.GetRendererID(), ib.GetRendererID() };
+	auto it = m_VertexArrays.find(key);
+	if (it != m_VertexArrays.end())
+	{
+		m_Stats.Hits++;
+		return it->second;
+	}
+
+	m_Stats.Misses++;
+	m_Stats.VertexArrays++;
+	VertexArray& va = m_VertexArrays[key];
+	va.AddBuffer(vb, layout);
+	va.SetIndexBuffer(ib);
+	return va;
+}
+
+const VertexArray& VertexArrayCache::Bind(const VertexBuffer& vb, const VertexLayoutView& layout, const IndexBuffer& ib)
+{
+	if (!m_UseAttribBinding || !CanShare(layout))
+	{
+		const VertexArray& va = Get(vb, layout, ib);
+		va.Bind();
+		return va;
+	}
+
+	const StoredLayout* stored = FindLayout(layout);
+	auto it = m_Shared.find(stored);
+	if (it == m_Shared.end())
+	{
+		m_Stats.Misses++;
+		m_Stats.VertexArrays++;
+		it = m_Shared.emplace(std::piecewise_construct, std::forward_as_tuple(stored), std::forward_as_tuple()).first;
+		it->second.VAO.SetFormat(layout);
+	}
+	else
+	{
+		m_Stats.Hits++;
+	}
+
+	SharedVertexArray& shared = it->second;
+	shared.VAO.Bind();
+	if (shared.VertexBuffer != vb.GetRendererID())
+	{
+		shared.VAO.BindVertexBuffer(vb, layout.Stride);
+		shared.VertexBuffer = vb.GetRendererID();
+		m_Stats.BufferSwaps++;
+	}
+	if (shared.IndexBuffer != ib.GetRendererID())
+	{
+		ib.Bind();
+		shared.IndexBuffer = ib.GetRendererID();
+	}
+	return shared.VAO;
+}
+
+void VertexArrayCache::ForgetBuffer(unsigned int buffer)
+{
+	for (auto it = m_VertexArrays.begin(); it != m_VertexArrays.end(); )
+	{
+		if (it->first.VertexBuffer == buffer || it->first.IndexBuffer == buffer)
+		{
+			it = m_VertexArrays.erase(it);
+			m_Stats.VertexArrays--;
+		}
+		else
+			it++;
+	}
+
+	/* Shared vertex arrays stay, they just have to rebind next time. */
+	for (auto& shared : m_Shared)
+	{
+		if (shared.second.VertexBuffer == buffer)
+			shared.second.VertexBuffer = 0;
+		if (shared.second.IndexBuffer == buffer)
+			shared.second.IndexBuffer = 0;
+	}
+}
+
+void VertexArrayCache::ForgetBufferEverywhere(unsigned int buffer)
+{
+	for (VertexArrayCache* cache : s_Caches)
+		cache->ForgetBuffer(buffer);
+}
+
+void VertexArrayCache::Clear()
+{
+	m_VertexArrays.clear();
+	m_Shared.clear();
+	m_Layouts.clear();
+	m_Stats.VertexArrays = 0;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "VertexArray.h"
+
+class IndexBuffer;
+
+/* Hands out vertex arrays for (layout, vertex buffer, index buffer) tuples so meshes that are drawn
+again reuse the one set up the first time instead of creating and specifying a new one.
+With ARB_vertex_attrib_binding, Bind shares a single vertex array per layout and only swaps the buffers.
+Buffers are remembered by GL name, VertexBuffer and IndexBuffer forget theirs in every cache before deleting it
+since GL recycles names. */
+class VertexArrayCache
+{
+public:
+	struct Stats
+	{
+		unsigned int VertexArrays = 0;
+		unsigned int Hits = 0;
+		unsigned int Misses = 0;
+		/* glBindVertexBuffer calls made by Bind on a shared vertex array. */
+		unsigned int BufferSwaps = 0;
+	};
+
+private:
+	/* A copy of a layout seen before, every distinct layout is stored once so keys can compare it by address. */
+	struct StoredLayout
+	{
+		unsigned int Stride;
+		std::vector<VertexBufferElement> Elements;
+	};
+
+	struct Key
+	{
+		const StoredLayout* Layout;
+		unsigned int VertexBuffer;
+		unsigned int IndexBuffer;
+
+		bool operator==(const Key& other) const
+		{
+			return Layout == other.Layout && VertexBuffer == other.VertexBuffer && IndexBuffer == other.IndexBuffer;
+		}
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+
+	/* One vertex array per layout, the buffers currently bound to it are tracked to skip redundant swaps. */
+	struct SharedVertexArray
+	{
+		VertexArray VAO;
+		unsigned int VertexBuffer = 0;
+		unsigned int IndexBuffer = 0;
+	};
+
+	/* By hash, layouts whose hashes collide are told apart element by element. */
+	std::unordered_multimap<uint64_t, std::unique_ptr<StoredLayout>> m_Layouts;
+	std::unordered_map<Key, VertexArray, KeyHash> m_VertexArrays;
+	std::unordered_map<const StoredLayout*, SharedVertexArray> m_Shared;
+	bool m_UseAttribBinding;
+	Stats m_Stats;
+
+	/* FNV-1a over every element and the stride. */
+	static uint64_t HashLayout(const VertexLayoutView& layout);
+	static bool IsSameLayout(const StoredLayout& stored, const VertexLayoutView& layout);
+	/* Returns the stored copy of layout, adding one the first time it is seen. */
+	const StoredLayout* FindLayout(const VertexLayoutView& layout);
+	/* Per-binding divisors can't express layouts that mix per-vertex and per-instance elements. */
+	static bool CanShare(const VertexLayoutView& layout);
+
+public:
+	/* Attribute binding is only used if asked for and the driver has it (GL 4.3). */
+	explicit VertexArrayCache(bool useAttribBinding = true);
+	~VertexArrayCache();
+
+	VertexArrayCache(const VertexArrayCache&) = delete;
+	VertexArrayCache& operator=(const VertexArrayCache&) = delete;
+
+	/* A vertex array of its own for this tuple, safe to Submit to the render queue. */
+	const VertexArray& Get(const VertexBuffer& vb, const VertexLayoutView& layout, const IndexBuffer& ib);
+
+	/* Binds a vertex array drawing vb through layout with ib, for drawing right away with Renderer::Draw.
+	A shared vertex array is rebound to other buffers by the next Bind with the same layout, so never Submit the result. */
+	const VertexArray& Bind(const VertexBuffer& vb, const VertexLayoutView& layout, const IndexBuffer& ib);
+
+	/* Drops every vertex array that references buffer. */
+	void ForgetBuffer(unsigned int buffer);
+	/* ForgetBuffer on every live cache, called by VertexBuffer and IndexBuffer before they delete their buffer. */
+	static void ForgetBufferEverywhere(unsigned int buffer);
+	void Clear();
+
+	inline bool UsesAttribBinding() const { return m_UseAttribBinding; }
+	inline const Stats& GetStats() const { return m_Stats; }
+	/* Call once per frame to get per frame counters, VertexArrays is kept. */
+	inline void ResetStats() { m_Stats = { m_Stats.VertexArrays }; }
+};
@@ -1,29 +1,123 @@
 #include "VertexBuffer.h"
 #include "Renderer.h"
+#include "GLState.h"
+#include "VertexArrayCache.h"
 
-VertexBuffer::VertexBuffer(const void* data, unsigned int size)
+VertexBuffer::VertexBuffer(const void* data, unsigned int size, BufferUsage usage)
+    :m_Size(size), m_Usage(GetGLBufferUsage(usage)), m_Pending(usage != BufferUsage::Static)
 {
     /* Generate buffer that openGL will draw from and assigns ID to m_RenderID. */
-    GLCall(glGenBuffers(1, &m_RenderID));
+    m_RenderID = CreateBuffer(GL_ARRAY_BUFFER);
 
-    /* Bind Buffer */
-    GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_RenderID));
+    /* Initializes VertexBuffer's object data store. Mutable, SetData may grow or orphan it. */
+    SetBufferData(m_RenderID, GL_ARRAY_BUFFER, size, data, m_Usage);
+    m_Pending.Seed(data, size, size);
+}
+
+VertexBuffer::VertexBuffer(unsigned int size, BufferUsage usage)
+    :m_Size(size), m_Usage(GetGLBufferUsage(usage)), m_Pending(usage != BufferUsage::Static)
+{
+    m_RenderID = CreateBuffer(GL_ARRAY_BUFFER);
 
-    /* Initializes VertexBuffer's object data store. */
-    GLCall(glBufferData(GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW));
+    /* No data yet, contents come later through SetData. */
+    SetBufferData(m_RenderID, GL_ARRAY_BUFFER, size, nullptr, m_Usage);
+    m_Pending.Seed(nullptr, 0, size);
 }
 
 VertexBuffer::~VertexBuffer()
 {
+    Release();
+}
+
+VertexBuffer::VertexBuffer(VertexBuffer&& other) noexcept
+    :m_RenderID(other.m_RenderID), m_Size(other.m_Size), m_Usage(other.m_Usage), m_Pending(std::move(other.m_Pending))
+{
+    other.m_RenderID = 0;
+    other.m_Size = 0;
+}
+
+VertexBuffer& VertexBuffer::operator=(VertexBuffer&& other) noexcept
+{
+    if (this != &other)
+    {
+        Release();
+        m_RenderID = other.m_RenderID;
+        m_Size = other.m_Size;
+        m_Usage = other.m_Usage;
+        m_Pending = std::move(other.m_Pending);
+        other.m_RenderID = 0;
+        other.m_Size = 0;
+    }
+    return *this;
+}
+
+void VertexBuffer::Release()
+{
+    if (m_RenderID == 0)
+        return;
+
+    GLState::ForgetBuffer(m_RenderID);
+    VertexArrayCache::ForgetBufferEverywhere(m_RenderID);
     GLCall(glDeleteBuffers(1, &m_RenderID));
+    m_RenderID = 0;
+}
+
+void VertexBuffer::SetData(const void* data, unsigned int size)
+{
+    m_Pending.Clear();
+    if (size >= m_Size)
+    {
+        m_Size = size;
+        SetBufferData(m_RenderID, GL_ARRAY_BUFFER, size, data, m_Usage);
+    }
+    else
+    {
+        /* Orphan first, the driver hands out fresh storage instead of syncing with the GPU. */
+        SetBufferData(m_RenderID, GL_ARRAY_BUFFER, m_Size, nullptr, m_Usage);
+        SetBufferSubData(m_RenderID, GL_ARRAY_BUFFER, 0, size, data);
+    }
+    m_Pending.Seed(data, size, m_Size);
+}
+
+void VertexBuffer::SetSubData(const void* data, unsigned int size, unsigned int offset)
+{
+    ASSERT(offset + size <= m_Size);
+    /* Queued writes are older, they must not land on top of this one later. */
+    FlushUpdates();
+    SetBufferSubData(m_RenderID, GL_ARRAY_BUFFER, offset, size, data);
+    m_Pending.Mirror(data, size, offset);
+}
+
+void VertexBuffer::QueueSubData(const void* data, unsigned int size, unsigned int offset)
+{
+    ASSERT(offset + size <= m_Size);
+    m_Pending.Write(data, size, offset);
+}
+
+unsigned int VertexBuffer::FlushUpdates()
+{
+    return m_Pending.Upload(m_RenderID, m_Size, m_Usage);
+}
+
+void VertexBuffer::Invalidate()
+{
+    m_Pending.Clear();
+    if (GLEW_VERSION_4_3 || GLEW_ARB_invalidate_subdata)
+    {
+        GLCall(glInvalidateBufferData(m_RenderID));
+    }
+    else
+    {
+        SetBufferData(m_RenderID, GL_ARRAY_BUFFER, m_Size, nullptr, m_Usage);
+    }
 }
 
 void VertexBuffer::Bind() const
 {
-    GLCall(glBindBuffer(GL_ARRAY_BUFFER, m_RenderID));
+    GLState::BindBuffer(GL_ARRAY_BUFFER, m_RenderID);
 }
 
 void VertexBuffer::Unbind() const
 {
-    GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
 }
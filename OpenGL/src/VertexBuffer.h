@@ -1,15 +1,49 @@
 #pragma once
 
+#include "BufferUpdate.h"
+
 class VertexBuffer
 {
 private:
-	/* Id for openGl sate machine. */
+	/* Id for openGl sate machine, 0 once moved from. */
 	unsigned int m_RenderID;
+	/* Allocated bytes. */
+	unsigned int m_Size;
+	/* GL usage hint, passed again whenever the storage is reallocated. */
+	unsigned int m_Usage;
+	PendingBufferUpdates m_Pending;
+
+	void Release();
 public:
 	/* Size is in bytes. */
-	VertexBuffer(const void* data, unsigned int size);
+	VertexBuffer(const void* data, unsigned int size, BufferUsage usage = BufferUsage::Static);
+	/* Allocates size bytes of storage to be filled later with SetData. */
+	explicit VertexBuffer(unsigned int size, BufferUsage usage = BufferUsage::Dynamic);
 	~VertexBuffer();
 
+	/* Move only, a copy would delete the same GL buffer twice. */
+	VertexBuffer(const VertexBuffer&) = delete;
+	VertexBuffer& operator=(const VertexBuffer&) = delete;
+	VertexBuffer(VertexBuffer&& other) noexcept;
+	VertexBuffer& operator=(VertexBuffer&& other) noexcept;
+
+	/* Replaces the contents with size bytes of data, growing the buffer if it is too small. The old storage
+	is orphaned, so the upload doesn't wait for draws still reading it. Queued updates are dropped. */
+	void SetData(const void* data, unsigned int size);
+	/* Overwrites size bytes at offset right away, uploading queued updates first so writes land in order. */
+	void SetSubData(const void* data, unsigned int size, unsigned int offset);
+	/* Same, but only recorded until FlushUpdates, which merges nearby writes into one upload each.
+	Meant for many small per-frame changes like single vertices or objects. Dynamic and stream buffers keep
+	a CPU copy of their contents so writes with small gaps between them merge as well. */
+	void QueueSubData(const void* data, unsigned int size, unsigned int offset);
+	/* Uploads the queued updates, call before drawing from the buffer. Returns the number of uploads made. */
+	unsigned int FlushUpdates();
+	/* Tells the driver the contents are no longer needed, before rewriting all of it piece by piece. */
+	void Invalidate();
+
 	void Bind() const;
 	void Unbind() const;
-};
\ No newline at end of file
+
+	inline unsigned int GetRendererID() const { return m_RenderID; }
+	inline unsigned int GetSize() const { return m_Size; }
+};
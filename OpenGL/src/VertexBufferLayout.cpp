@@ -1,5 +1,25 @@
 #include "VertexBufferLayout.h"
+#include "Renderer.h"
 
 VertexBufferLayout::~VertexBufferLayout()
 {
 }
+
+unsigned int VertexBufferElement::GetSizeOfType(unsigned int type)
+{
+	switch(type)
+	{
+		case GL_FLOAT:			return 4;
+		case GL_UNSIGNED_INT:	return 4;
+		case GL_INT:			return 4;
+		case GL_HALF_FLOAT:		return 2;
+		case GL_UNSIGNED_SHORT:	return 2;
+		case GL_SHORT:			return 2;
+		case GL_UNSIGNED_BYTE:	return 1;
+		case GL_BYTE:			return 1;
+	}
+
+	/* Trigger if no type is matched. */
+	ASSERT(false);
+	return 0;
+}
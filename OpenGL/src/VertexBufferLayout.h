@@ -2,10 +2,13 @@
 
 #include <GL/glew.h>
 
-#include<vector>
-#include <stdexcept>
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
 
-#include "Renderer.h"
+#include "glm/glm.hpp"
+#include "glm/gtc/type_precision.hpp"
 
 
 
@@ -14,22 +17,109 @@ struct VertexBufferElement
 	unsigned int count;
 	unsigned int type;
 	unsigned char normalized;
+	/* 0 advances per vertex, n advances once every n instances. */
+	unsigned int divisor;
+	/* Bytes from the start of the vertex. */
+	unsigned int offset;
+	/* Attribute locations taken, a matrix uses one per column. */
+	unsigned int locations;
+	/* Read as int/uint in the shader instead of being converted to float. */
+	unsigned char integer;
+
+	static unsigned int GetSizeOfType(unsigned int type);
+};
 
-	static unsigned int GetSizeOfType(unsigned int type)
-	{
-		switch(type)
-		{
-			case GL_FLOAT:			return 4;
-			case GL_UNSIGNED_INT:	return 4;
-			case GL_UNSIGNED_BYTE:	return 1;
-		}
-		
-		/* Trigger if no type is matched. */
-		ASSERT(false);
-		return 0;
-	}
+template<typename T>
+struct AlwaysFalse : std::false_type {};
+
+/* How a C++ type is fed to a vertex attribute, Columns > 1 spreads it over several locations. */
+template<unsigned int ComponentCount, unsigned int GLType, unsigned char IsNormalized, unsigned int ColumnCount = 1, unsigned char IsInteger = GL_FALSE>
+struct VertexAttributeFormat
+{
+	static constexpr unsigned int Count = ComponentCount;
+	static constexpr unsigned int Type = GLType;
+	static constexpr unsigned char Normalized = IsNormalized;
+	static constexpr unsigned int Columns = ColumnCount;
+	static constexpr unsigned char Integer = IsInteger;
+};
+
+template<unsigned int ComponentCount, unsigned int GLType>
+struct IntegerAttributeFormat : VertexAttributeFormat<ComponentCount, GLType, GL_FALSE, 1, GL_TRUE> {};
+
+/* Compact storage types, so they get their own formats instead of being read as plain integers.
+MeshQuantizer fills them from float data. */
+struct Half2 { glm::u16vec2 Value; };
+struct Half4 { glm::u16vec4 Value; };
+/* Read as 0 to 1. */
+struct UNorm16x2 { glm::u16vec2 Value; };
+/* Read as -1 to 1. */
+struct SNorm16x4 { glm::i16vec4 Value; };
+/* x, y, z in 10 bits each from bit 0 up, w in the top 2, read as -1 to 1. */
+struct PackedNormal { glm::uint32 Value; };
+
+/* Types without a specialization don't compile when used in a layout. */
+template<typename T>
+struct VertexAttributeTraits
+{
+	static_assert(AlwaysFalse<T>::value, "No vertex attribute format for this type, add a VertexAttributeTraits specialization.");
+};
+
+template<> struct VertexAttributeTraits<float> : VertexAttributeFormat<1, GL_FLOAT, GL_FALSE> {};
+template<> struct VertexAttributeTraits<glm::vec2> : VertexAttributeFormat<2, GL_FLOAT, GL_FALSE> {};
+template<> struct VertexAttributeTraits<glm::vec3> : VertexAttributeFormat<3, GL_FLOAT, GL_FALSE> {};
+template<> struct VertexAttributeTraits<glm::vec4> : VertexAttributeFormat<4, GL_FLOAT, GL_FALSE> {};
+template<> struct VertexAttributeTraits<Half2> : VertexAttributeFormat<2, GL_HALF_FLOAT, GL_FALSE> {};
+template<> struct VertexAttributeTraits<Half4> : VertexAttributeFormat<4, GL_HALF_FLOAT, GL_FALSE> {};
+template<> struct VertexAttributeTraits<UNorm16x2> : VertexAttributeFormat<2, GL_UNSIGNED_SHORT, GL_TRUE> {};
+template<> struct VertexAttributeTraits<SNorm16x4> : VertexAttributeFormat<4, GL_SHORT, GL_TRUE> {};
+template<> struct VertexAttributeTraits<PackedNormal> : VertexAttributeFormat<4, GL_INT_2_10_10_10_REV, GL_TRUE> {};
+/* Integers stay integers, declare them int/uint or ivec/uvec in the shader. */
+template<> struct VertexAttributeTraits<int> : IntegerAttributeFormat<1, GL_INT> {};
+template<> struct VertexAttributeTraits<glm::ivec2> : IntegerAttributeFormat<2, GL_INT> {};
+template<> struct VertexAttributeTraits<glm::ivec3> : IntegerAttributeFormat<3, GL_INT> {};
+template<> struct VertexAttributeTraits<glm::ivec4> : IntegerAttributeFormat<4, GL_INT> {};
+template<> struct VertexAttributeTraits<unsigned int> : IntegerAttributeFormat<1, GL_UNSIGNED_INT> {};
+template<> struct VertexAttributeTraits<glm::uvec2> : IntegerAttributeFormat<2, GL_UNSIGNED_INT> {};
+template<> struct VertexAttributeTraits<glm::uvec3> : IntegerAttributeFormat<3, GL_UNSIGNED_INT> {};
+template<> struct VertexAttributeTraits<glm::uvec4> : IntegerAttributeFormat<4, GL_UNSIGNED_INT> {};
+template<> struct VertexAttributeTraits<glm::u16vec2> : IntegerAttributeFormat<2, GL_UNSIGNED_SHORT> {};
+template<> struct VertexAttributeTraits<glm::u16vec4> : IntegerAttributeFormat<4, GL_UNSIGNED_SHORT> {};
+/* Loose bytes are colors, read as 0 to 1. */
+template<> struct VertexAttributeTraits<unsigned char> : VertexAttributeFormat<1, GL_UNSIGNED_BYTE, GL_TRUE> {};
+template<> struct VertexAttributeTraits<glm::u8vec4> : VertexAttributeFormat<4, GL_UNSIGNED_BYTE, GL_TRUE> {};
+/* A mat4 takes four attribute locations, one vec4 column each. */
+template<> struct VertexAttributeTraits<glm::mat4> : VertexAttributeFormat<4, GL_FLOAT, GL_FALSE, 4> {};
+
+template<typename T>
+constexpr VertexBufferElement MakeVertexElement(unsigned int offset, unsigned int divisor = 0)
+{
+	return { VertexAttributeTraits<T>::Count, VertexAttributeTraits<T>::Type, VertexAttributeTraits<T>::Normalized,
+		divisor, offset, VertexAttributeTraits<T>::Columns, VertexAttributeTraits<T>::Integer };
+}
+
+/* Element for a member of a vertex struct, the type and offset come from the struct itself. */
+#define VERTEX_ATTRIBUTE(Vertex, Member) MakeVertexElement<decltype(Vertex::Member)>((unsigned int)offsetof(Vertex, Member))
+/* Same for per-instance data, advancing once every divisor instances. */
+#define INSTANCE_ATTRIBUTE(Vertex, Member, divisor) MakeVertexElement<decltype(Vertex::Member)>((unsigned int)offsetof(Vertex, Member), divisor)
+
+/* Layout fixed at compile time, AddBuffer walks the array without allocating. */
+template<std::size_t N>
+struct VertexLayout
+{
+	std::array<VertexBufferElement, N> Elements;
+	unsigned int Stride;
 };
 
+/* Builds the layout of Vertex from VERTEX_ATTRIBUTE entries, in attribute location order:
+constexpr auto layout = MakeVertexLayout<QuadVertex>(VERTEX_ATTRIBUTE(QuadVertex, Position), ...); */
+template<typename Vertex, typename... Elements>
+constexpr VertexLayout<sizeof...(Elements)> MakeVertexLayout(const Elements&... elements)
+{
+	static_assert(std::is_standard_layout<Vertex>::value, "Vertex has to be standard layout for offsetof.");
+	return { { { elements... } }, (unsigned int)sizeof(Vertex) };
+}
+
+/* Layout built at runtime, for data that has no vertex struct. */
 class VertexBufferLayout
 {
 private:
@@ -42,34 +132,45 @@ public:
 
 	~VertexBufferLayout();
 
+	/* Appends count values of T. Scalars are gathered into one attribute, Push<float>(3) is a vec3. Vector, packed
+	and matrix types get an attribute per value, since their components can't be widened. A non zero divisor marks
+	the attribute as per-instance. */
 	template<typename T>
-	void Push(unsigned int count) 
+	void Push(unsigned int count, unsigned int divisor = 0)
 	{
-		std::runtime_error(false);
+		typedef VertexAttributeTraits<T> Traits;
+		if (Traits::Columns == 1 && Traits::Count == 1)
+		{
+			m_Elements.push_back(MakeVertexElement<T>(m_Stride, divisor));
+			m_Elements.back().count *= count;
+		}
+		else
+		{
+			for (unsigned int i = 0; i < count; i++)
+				m_Elements.push_back(MakeVertexElement<T>(m_Stride + i * (unsigned int)sizeof(T), divisor));
+		}
+		m_Stride += (unsigned int)sizeof(T) * count;
 	}
 
-	template<>
-	void Push<float>(unsigned int count)
-	{
-		m_Elements.push_back({ count, GL_FLOAT, GL_FALSE });
-		m_Stride += VertexBufferElement::GetSizeOfType(GL_FLOAT) * count;
-	}
+	inline unsigned int GetStride() const { return m_Stride;  }
 
-	template<>
-	void Push<unsigned int>(unsigned int count)
-	{
-		m_Elements.push_back({ count, GL_UNSIGNED_INT, GL_FALSE });
-		m_Stride += VertexBufferElement::GetSizeOfType(GL_UNSIGNED_INT) * count;
-	}
+	inline const std::vector<VertexBufferElement>& GetElements() const { return m_Elements;  }
+};
 
-	template<>
-	void Push<unsigned char>(unsigned int count)
-	{
-		m_Elements.push_back({ count, GL_UNSIGNED_BYTE, GL_TRUE });
-		m_Stride += VertexBufferElement::GetSizeOfType(GL_UNSIGNED_BYTE) * count;
-	}
+/* Non-owning view of either kind of layout, this is what VertexArray consumes. */
+struct VertexLayoutView
+{
+	const VertexBufferElement* Elements;
+	unsigned int Count;
+	unsigned int Stride;
 
-	inline unsigned int GetStride() const { return m_Stride;  }
+	VertexLayoutView(const VertexBufferElement* elements, unsigned int count, unsigned int stride)
+		:Elements(elements), Count(count), Stride(stride) {}
+
+	VertexLayoutView(const VertexBufferLayout& layout)
+		:Elements(layout.GetElements().data()), Count((unsigned int)layout.GetElements().size()), Stride(layout.GetStride()) {}
 
-	inline const std::vector<VertexBufferElement> GetElements() const { return m_Elements;  }
+	template<std::size_t N>
+	VertexLayoutView(const VertexLayout<N>& layout)
+		:Elements(layout.Elements.data()), Count((unsigned int)N), Stride(layout.Stride) {}
 };